@@ -0,0 +1,192 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <regex>
+#include <thread>
+#include "Benchmark.h"
+
+/* Implementation of class "BenchmarkRegistry" */
+
+BenchmarkRegistry &BenchmarkRegistry::getInstance()
+{
+    static BenchmarkRegistry registry;
+    return registry;
+}
+
+int BenchmarkRegistry::add(const std::string &name, BenchmarkFunction function, const std::vector<std::vector<long>> &argSets)
+{
+    for (auto &args : argSets)
+    {
+        // name every run after its arguments, e.g. "VehicleSteps/1000/8"
+        std::string runName = name;
+        for (long arg : args)
+        {
+            runName += "/" + std::to_string(arg);
+        }
+        _entries.push_back(Entry{runName, function, args});
+    }
+    return (int)_entries.size();
+}
+
+std::vector<std::vector<long>> BenchmarkRegistry::argProduct(const std::vector<std::vector<long>> &axes)
+{
+    std::vector<std::vector<long>> argSets(1);
+    for (auto &axis : axes)
+    {
+        std::vector<std::vector<long>> extended;
+        for (auto &args : argSets)
+        {
+            for (long value : axis)
+            {
+                extended.push_back(args);
+                extended.back().push_back(value);
+            }
+        }
+        argSets = extended;
+    }
+    return argSets;
+}
+
+int BenchmarkRegistry::runAll(int argc, char *argv[])
+{
+    // parse command line options, using the flag names of Google Benchmark
+    // --benchmark_filter=<regex>     : only run benchmarks whose name matches (default: all)
+    // --benchmark_min_time=<s>       : minimum measured time per benchmark (default: 0.5)
+    // --benchmark_format=<console|json> : format of the report written to stdout (default: console)
+    // --benchmark_out=<file>         : additionally write the JSON report to a file
+    // --benchmark_list_tests         : print the names of all benchmarks and exit
+    std::string filter = ".";
+    double minTime = 0.5;
+    bool isJson = false;
+    bool isListOnly = false;
+    std::string outFile;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto value = [&arg]() { return arg.substr(arg.find('=') + 1); };
+        if (arg.rfind("--benchmark_filter=", 0) == 0)
+        {
+            filter = value();
+        }
+        else if (arg.rfind("--benchmark_min_time=", 0) == 0)
+        {
+            minTime = std::stod(value());
+        }
+        else if (arg == "--benchmark_format=json" || arg == "--benchmark_format=console")
+        {
+            isJson = value() == "json";
+        }
+        else if (arg.rfind("--benchmark_out=", 0) == 0)
+        {
+            outFile = value();
+        }
+        else if (arg == "--benchmark_list_tests")
+        {
+            isListOnly = true;
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--benchmark_filter=<regex>] [--benchmark_min_time=<s>] [--benchmark_format=<console|json>] [--benchmark_out=<file>] [--benchmark_list_tests]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::regex pattern(filter);
+    std::vector<std::pair<const Entry *, BenchmarkState>> results;
+    if (!isJson && !isListOnly)
+    {
+        std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(16) << "Time [ns]" << std::setw(16) << "CPU [ns]"
+                  << std::setw(12) << "Iterations" << std::setw(16) << "items/s" << std::endl;
+        std::cout << std::string(100, '-') << std::endl;
+    }
+    for (auto &entry : _entries)
+    {
+        if (!std::regex_search(entry.name, pattern))
+        {
+            continue;
+        }
+        if (isListOnly)
+        {
+            std::cout << entry.name << std::endl;
+            continue;
+        }
+
+        BenchmarkState state(entry.args, minTime);
+        entry.function(state);
+        results.emplace_back(&entry, state);
+
+        if (!isJson)
+        {
+            std::cout << std::left << std::setw(40) << entry.name << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(16) << state.getRealTime() << std::setw(16) << state.getCpuTime() << std::setw(12) << state.getIterations()
+                      << std::setprecision(3) << std::scientific << std::setw(16) << state.getItemsPerSecond();
+            for (auto &counter : state.getCounters())
+            {
+                std::cout << " " << counter.first << "=" << std::defaultfloat << std::setprecision(10) << counter.second;
+            }
+            std::cout << std::defaultfloat << std::endl;
+        }
+    }
+    if (isListOnly)
+    {
+        return 0;
+    }
+
+    // assemble the JSON report in the layout of Google Benchmark
+    std::ostringstream json;
+    std::time_t now = std::time(nullptr);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    json << std::setprecision(10);
+    json << "{\n  \"context\": {\n";
+    json << "    \"date\": \"" << date << "\",\n";
+    json << "    \"executable\": \"" << argv[0] << "\",\n";
+    json << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    json << "    \"library_build_type\": \"release\"\n";
+#else
+    json << "    \"library_build_type\": \"debug\"\n";
+#endif
+    json << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkState &state = results[i].second;
+        json << (i > 0 ? "," : "") << "\n    {\n";
+        json << "      \"name\": \"" << results[i].first->name << "\",\n";
+        json << "      \"run_name\": \"" << results[i].first->name << "\",\n";
+        json << "      \"run_type\": \"iteration\",\n";
+        json << "      \"iterations\": " << state.getIterations() << ",\n";
+        json << "      \"real_time\": " << state.getRealTime() << ",\n";
+        json << "      \"cpu_time\": " << state.getCpuTime() << ",\n";
+        json << "      \"time_unit\": \"ns\",\n";
+        for (auto &counter : state.getCounters())
+        {
+            json << "      \"" << counter.first << "\": " << counter.second << ",\n";
+        }
+        json << "      \"items_per_second\": " << state.getItemsPerSecond() << "\n    }";
+    }
+    json << "\n  ]\n}\n";
+
+    if (isJson)
+    {
+        std::cout << json.str();
+    }
+    if (!outFile.empty())
+    {
+        std::ofstream out(outFile);
+        if (!out)
+        {
+            std::cerr << "Cannot write " << outFile << std::endl;
+            return 1;
+        }
+        out << json.str();
+    }
+    return 0;
+}
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+    return BenchmarkRegistry::getInstance().runAll(argc, argv);
+}
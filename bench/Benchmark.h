@@ -0,0 +1,119 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <ctime>
+#include <algorithm>
+
+// minimal benchmark harness following the conventions of Google Benchmark (argument sweeps,
+// adaptive iteration counts, items per second, --benchmark_* flags and its JSON report format),
+// so results can be compared with the usual tooling without adding a dependency.
+
+// keeps the compiler from optimizing away a value computed by the benchmarked code
+template <class T>
+inline void doNotOptimize(T const &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// handed to every benchmark run : provides the arguments and collects the measurement
+class BenchmarkState
+{
+public:
+    // constructor / desctructor
+    BenchmarkState(const std::vector<long> &args, double minTime) : _args(args), _minTime(minTime) {}
+
+    // getters / setters
+    long getArg(size_t idx) const { return _args.at(idx); }
+    void setCounter(const std::string &name, double value) { _counters[name] = value; }
+    long getIterations() const { return _nIterations; }
+    double getRealTime() const { return _realTime; } // per iteration in ns
+    double getCpuTime() const { return _cpuTime; }   // per iteration in ns
+    double getItemsPerSecond() const { return _itemsPerSecond; }
+    const std::map<std::string, double> &getCounters() const { return _counters; }
+
+    // typical behaviour methods
+
+    // calls work in batches of growing size until a batch takes at least the minimum time,
+    // every call processes itemsPerCall items (vehicle steps, admissions, messages, ...).
+    // Set-up code before and tear-down code after this call is not measured.
+    template <class Work>
+    void measure(Work &&work, double itemsPerCall)
+    {
+        long nIterations = 1;
+        while (true)
+        {
+            std::clock_t cpuStart = std::clock();
+            auto start = std::chrono::steady_clock::now();
+            for (long i = 0; i < nIterations; i++)
+            {
+                work();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            double cpuElapsed = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+            if (elapsed.count() >= _minTime || nIterations >= _maxIterations)
+            {
+                _nIterations = nIterations;
+                _realTime = elapsed.count() * 1e9 / nIterations;
+                _cpuTime = cpuElapsed * 1e9 / nIterations;
+                _itemsPerSecond = itemsPerCall * nIterations / std::max(elapsed.count(), 1e-12);
+                return;
+            }
+
+            // predict the batch size reaching the minimum time, growing by at most a factor of 100
+            double scale = elapsed.count() > 0.0 ? 1.4 * _minTime / elapsed.count() : 100.0;
+            nIterations = std::min(_maxIterations, (long)(nIterations * std::min(std::max(scale, 2.0), 100.0)));
+        }
+    }
+
+private:
+    static const long _maxIterations = 1000000000;
+
+    std::vector<long> _args;                  // arguments of this run, e.g. number of vehicles
+    double _minTime;                          // minimum duration of the measured batch in s
+    long _nIterations = 0;                    // number of calls in the measured batch
+    double _realTime = 0.0;                   // wall-clock time per call in ns
+    double _cpuTime = 0.0;                    // process cpu time per call in ns (includes all threads)
+    double _itemsPerSecond = 0.0;             // throughput of the measured batch
+    std::map<std::string, double> _counters;  // additional user counters reported with the run
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState &state);
+
+// registry of all benchmarks linked into the executable, runs them and reports the results
+class BenchmarkRegistry
+{
+public:
+    // getters / setters
+    static BenchmarkRegistry &getInstance();
+
+    // typical behaviour methods
+    int add(const std::string &name, BenchmarkFunction function, const std::vector<std::vector<long>> &argSets);
+    int runAll(int argc, char *argv[]);
+
+    // miscellaneous
+    static std::vector<std::vector<long>> argProduct(const std::vector<std::vector<long>> &axes); // cartesian product of argument ranges
+
+private:
+    struct Entry
+    {
+        std::string name;
+        BenchmarkFunction function;
+        std::vector<long> args;
+    };
+
+    std::vector<Entry> _entries; // one entry per benchmark and argument set, in registration order
+};
+
+// registers a benchmark function with a list of argument sets at static initialization time,
+// a function may be registered several times with different sweeps
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_REGISTER(name, function, ...) \
+    static int BENCHMARK_CONCAT(isRegistered, __LINE__) = BenchmarkRegistry::getInstance().add(name, function, __VA_ARGS__)
+
+#endif
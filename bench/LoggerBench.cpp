@@ -0,0 +1,70 @@
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include "Logger.h"
+#include "Benchmark.h"
+
+// contention microbenchmarks comparing the Logger with a mutex-guarded stream flushed after every line
+
+// stream buffer discarding everything, so that only the cost of logging itself is measured
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+static NullBuffer nullBuffer;
+static std::ostream nullStream(&nullBuffer);
+
+// every thread logs nMessagesPerThread entry grants
+template <class Log>
+void runLogThreads(int nThreads, int nMessagesPerThread, Log log)
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++)
+    {
+        threads.emplace_back([t, nMessagesPerThread, &log]() {
+            for (int m = 0; m < nMessagesPerThread; m++)
+            {
+                log(t, m);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// items are messages : LogMessages/Mutex/<threads>
+void LogMessagesMutex(BenchmarkState &state)
+{
+    int nThreads = state.getArg(0);
+    const int nMessagesPerThread = 1000;
+    static std::mutex mtx;
+    state.measure([=]() {
+        runLogThreads(nThreads, nMessagesPerThread, [](int t, int m) {
+            std::lock_guard<std::mutex> lock(mtx);
+            nullStream << "Intersection #" << t << ": Vehicle #" << m << " is granted entry." << std::endl;
+        });
+    }, (double)nThreads * nMessagesPerThread);
+}
+BENCHMARK_REGISTER("LogMessages/Mutex", LogMessagesMutex, {{1}, {4}, {16}});
+
+// items are messages, including those dropped by full rings : LogMessages/Logger/<threads>
+void LogMessagesLogger(BenchmarkState &state)
+{
+    int nThreads = state.getArg(0);
+    const int nMessagesPerThread = 1000;
+    Logger::getInstance().setOutput(nullStream);
+    state.measure([=]() {
+        runLogThreads(nThreads, nMessagesPerThread, []([[maybe_unused]] int t, [[maybe_unused]] int m) {
+            LOG_INFO("Intersection #{}: Vehicle #{} is granted entry.", t, m);
+        });
+    }, (double)nThreads * nMessagesPerThread);
+    Logger::getInstance().flush();
+}
+BENCHMARK_REGISTER("LogMessages/Logger", LogMessagesLogger, {{1}, {4}, {16}});
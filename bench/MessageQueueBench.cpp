@@ -0,0 +1,101 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "MessageQueue.h"
+#include "Benchmark.h"
+
+// contention microbenchmarks comparing the MessageQueue policies
+
+// many producers, one consumer : sends nMessagesPerProducer messages from every producer
+template <template <class> class QueuePolicy>
+void runMpsc(int nProducers, int nMessagesPerProducer)
+{
+    MessageQueue<int, QueuePolicy> queue;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < nProducers; p++)
+    {
+        producers.emplace_back([&queue, nMessagesPerProducer]() {
+            for (int m = 0; m < nMessagesPerProducer; m++)
+            {
+                queue.send(std::move(m));
+            }
+        });
+    }
+
+    long checksum = 0;
+    for (long m = 0; m < (long)nProducers * nMessagesPerProducer; m++)
+    {
+        checksum += queue.receive();
+    }
+    for (auto &t : producers)
+    {
+        t.join();
+    }
+
+    if (checksum != (long)nProducers * nMessagesPerProducer * (nMessagesPerProducer - 1) / 2)
+    {
+        std::cerr << "checksum mismatch" << std::endl;
+    }
+}
+
+// one sender waking many waiting receivers per phase change.
+// With a deque every receiver consumes its own copy, so a phase change costs one send per receiver.
+void runFanOutDeque(int nReceivers, int nRounds)
+{
+    MessageQueue<int, DequeQueue> queue;
+    std::atomic<long> nAcks(0);
+
+    std::vector<std::thread> receivers;
+    for (int r = 0; r < nReceivers; r++)
+    {
+        receivers.emplace_back([&queue, &nAcks, nRounds]() {
+            for (int round = 0; round < nRounds; round++)
+            {
+                queue.receive();
+                nAcks++;
+            }
+        });
+    }
+
+    for (int round = 1; round <= nRounds; round++)
+    {
+        for (int r = 0; r < nReceivers; r++)
+        {
+            queue.send(std::move(round));
+        }
+        while (nAcks < (long)round * nReceivers)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto &t : receivers)
+    {
+        t.join();
+    }
+}
+
+// items are received messages : MessageQueueMpsc/<policy>/<producers>
+void MessageQueueMpscDeque(BenchmarkState &state)
+{
+    int nProducers = state.getArg(0), nMessagesPerProducer = 20000;
+    state.measure([=]() { runMpsc<DequeQueue>(nProducers, nMessagesPerProducer); }, (double)nProducers * nMessagesPerProducer);
+}
+BENCHMARK_REGISTER("MessageQueueMpsc/Deque", MessageQueueMpscDeque, {{1}, {2}, {4}, {8}, {16}});
+
+void MessageQueueMpscRing(BenchmarkState &state)
+{
+    int nProducers = state.getArg(0), nMessagesPerProducer = 20000;
+    state.measure([=]() { runMpsc<MpscRingQueue>(nProducers, nMessagesPerProducer); }, (double)nProducers * nMessagesPerProducer);
+}
+BENCHMARK_REGISTER("MessageQueueMpsc/Ring", MessageQueueMpscRing, {{1}, {2}, {4}, {8}, {16}});
+
+// items are phase changes seen by all receivers : MessageQueueFanOut/<policy>/<receivers>
+void MessageQueueFanOutDeque(BenchmarkState &state)
+{
+    int nReceivers = state.getArg(0), nRounds = 200;
+    state.measure([=]() { runFanOutDeque(nReceivers, nRounds); }, nRounds);
+}
+BENCHMARK_REGISTER("MessageQueueFanOut/Deque", MessageQueueFanOutDeque, {{1}, {4}, {16}, {64}});
@@ -0,0 +1,338 @@
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include "World.h"
+#include "Scheduler.h"
+#include "CityMap.h"
+#include "BatchRunner.h"
+#include "Checkpoint.h"
+#include "Benchmark.h"
+
+// benchmarks of the simulation core, run headless on the engine without pacing to wall-clock time
+
+// square grid of nSide x nSide intersections connected by horizontal and vertical streets,
+// vehicles are distributed round-robin over all streets
+void createGridWorld(World &world, int nSide, long nVehicles)
+{
+    for (int r = 0; r < nSide; r++)
+    {
+        for (int c = 0; c < nSide; c++)
+        {
+            world.addIntersection()->setPosition(100 * c, 100 * r);
+        }
+    }
+
+    std::vector<std::shared_ptr<Intersection>> &intersections = world.getIntersections();
+    for (int r = 0; r < nSide; r++)
+    {
+        for (int c = 0; c < nSide; c++)
+        {
+            if (c + 1 < nSide)
+            {
+                std::shared_ptr<Street> street = world.addStreet();
+                street->setInIntersection(*intersections[r * nSide + c]);
+                street->setOutIntersection(*intersections[r * nSide + c + 1]);
+            }
+            if (r + 1 < nSide)
+            {
+                std::shared_ptr<Street> street = world.addStreet();
+                street->setInIntersection(*intersections[r * nSide + c]);
+                street->setOutIntersection(*intersections[(r + 1) * nSide + c]);
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<Street>> &streets = world.getStreets();
+    for (long nv = 0; nv < nVehicles; nv++)
+    {
+        Street &street = *streets[nv % streets.size()];
+        std::shared_ptr<Vehicle> vehicle = world.addVehicle();
+        vehicle->setCurrentStreet(street);
+        vehicle->setCurrentDestination(world.getIntersection(street.getOutIntersectionID()));
+    }
+    world.buildRoadGraph();
+}
+
+// single intersection with nStreets dead-end streets around it, the center has id 0
+void createStarWorld(World &world, int nStreets)
+{
+    world.addIntersection()->setPosition(0, 0);
+    for (int ns = 0; ns < nStreets; ns++)
+    {
+        std::shared_ptr<Intersection> end = world.addIntersection();
+        end->setPosition(100 * ns, 100);
+        std::shared_ptr<Street> street = world.addStreet();
+        street->setInIntersection(*end);
+        street->setOutIntersection(world.getIntersection(0));
+    }
+    world.buildRoadGraph();
+}
+
+// items are vehicle steps : VehicleSteps/<vehicles>/<grid side>/<workers>
+void VehicleSteps(BenchmarkState &state)
+{
+    long nVehicles = state.getArg(0);
+    int nSide = state.getArg(1);
+    int nWorkers = state.getArg(2);
+    const double tickDuration = 0.01; // in s
+    const long nTicksPerCall = 10;
+
+    World world;
+    world.setSeed(42);
+    createGridWorld(world, nSide, nVehicles);
+    Scheduler scheduler(world);
+    scheduler.setIsRealTime(false);
+    scheduler.setNumWorkers(nWorkers);
+    scheduler.setTickDuration(tickDuration);
+
+    auto runTicks = [&scheduler, tickDuration](long nTicks) {
+        scheduler.setEndTime((scheduler.getTickCount() + nTicks - 0.5) * tickDuration);
+        scheduler.simulate();
+        scheduler.waitUntilFinished();
+    };
+
+    // warm up until vehicles queue in front of intersections and admissions take place
+    runTicks(250);
+
+    state.measure([&runTicks, nTicksPerCall]() { runTicks(nTicksPerCall); }, (double)nTicksPerCall * nVehicles);
+    state.setCounter("intersections", world.getIntersections().size());
+    state.setCounter("streets", world.getStreets().size());
+}
+BENCHMARK_REGISTER("VehicleSteps", VehicleSteps,
+                   BenchmarkRegistry::argProduct({{1, 10, 100, 1000, 10000, 100000, 1000000}, {8}, {1}}));
+BENCHMARK_REGISTER("VehicleSteps", VehicleSteps, BenchmarkRegistry::argProduct({{10000}, {2, 32, 128, 256}, {1}}));
+BENCHMARK_REGISTER("VehicleSteps", VehicleSteps, BenchmarkRegistry::argProduct({{100000}, {64}, {1, 2, 4, 8}}));
+
+// items are vehicle steps on a single street, whose vehicles follow each other : DenseStreetSteps/<vehicles>/<lanes>
+void DenseStreetSteps(BenchmarkState &state)
+{
+    long nVehicles = state.getArg(0);
+    int nLanes = state.getArg(1);
+    const double tickDuration = 0.01; // in s
+    const long nTicksPerCall = 10;
+
+    // a street long enough that no vehicle reaches its end during the benchmark
+    World world;
+    world.setSeed(42);
+    world.addIntersection()->setPosition(0, 0);
+    world.addIntersection()->setPosition(1000, 0);
+    std::shared_ptr<Street> street = world.addStreet();
+    street->setLength(1e7);
+    street->setNumLanes(nLanes);
+    street->setInIntersection(world.getIntersection(0));
+    street->setOutIntersection(world.getIntersection(1));
+    for (long nv = 0; nv < nVehicles; nv++)
+    {
+        std::shared_ptr<Vehicle> vehicle = world.addVehicle();
+        vehicle->setCurrentStreet(*street);
+        vehicle->setCurrentDestination(world.getIntersection(1));
+    }
+    world.buildRoadGraph();
+    Scheduler scheduler(world);
+    scheduler.setIsRealTime(false);
+    scheduler.setNumWorkers(1);
+    scheduler.setTickDuration(tickDuration);
+
+    auto runTicks = [&scheduler, tickDuration](long nTicks) {
+        scheduler.setEndTime((scheduler.getTickCount() + nTicks - 0.5) * tickDuration);
+        scheduler.simulate();
+        scheduler.waitUntilFinished();
+    };
+
+    // warm up until the vehicles, which all start at the beginning of the street, have spread out behind each other
+    runTicks(500);
+
+    state.measure([&runTicks, nTicksPerCall]() { runTicks(nTicksPerCall); }, (double)nTicksPerCall * nVehicles);
+}
+BENCHMARK_REGISTER("DenseStreetSteps", DenseStreetSteps, BenchmarkRegistry::argProduct({{10, 100, 1000, 10000}, {1, 4}}));
+
+// items are admissions : IntersectionAdmissions/<vehicles waiting at once>
+void IntersectionAdmissions(BenchmarkState &state)
+{
+    int nWaiting = state.getArg(0);
+
+    // crossing whose streets leave east, north, west and south, the north-south approaches share a light which never turns red
+    World world;
+    world.addIntersection()->setPosition(0, 0);
+    const int ends[4][2] = {{100, 0}, {0, -100}, {-100, 0}, {0, 100}};
+    for (auto &end : ends)
+    {
+        std::shared_ptr<Intersection> intersection = world.addIntersection();
+        intersection->setPosition(end[0], end[1]);
+        std::shared_ptr<Street> street = world.addStreet();
+        street->setInIntersection(world.getIntersection(0));
+        street->setOutIntersection(*intersection);
+    }
+    world.buildRoadGraph();
+    Intersection &intersection = world.getIntersection(0);
+    intersection.setSignalPlan(SignalPlan{1.0, 1.0, 0.0});
+
+    // queue all vehicles alternately from north and south driving straight on, then let the two
+    // non-conflicting front vehicles enter and leave together
+    std::vector<EntryWaiter> grants(nWaiting);
+    state.measure([&intersection, &grants, nWaiting]() {
+        for (int nv = 0; nv < nWaiting; nv++)
+        {
+            int approach = 1 + 2 * (nv % 2);
+            intersection.requestEntry(nv, approach, 4 - approach, grants[nv]);
+        }
+        for (int nv = 0; nv < nWaiting; nv += 2)
+        {
+            intersection.step();
+            for (int ng = nv; ng < nv + 2 && ng < nWaiting; ng++)
+            {
+                grants[ng].wait();
+                intersection.vehicleHasLeft(ng);
+            }
+        }
+    }, nWaiting);
+}
+BENCHMARK_REGISTER("IntersectionAdmissions", IntersectionAdmissions, {{1}, {16}, {256}, {4096}});
+
+// items are queries : IntersectionQueryStreets/<streets at the intersection>
+void IntersectionQueryStreets(BenchmarkState &state)
+{
+    int nStreets = state.getArg(0);
+    World world;
+    createStarWorld(world, nStreets);
+
+    Intersection &center = world.getIntersection(0);
+    std::vector<int> outgoingIDs;
+    int incomingID = 0;
+    state.measure([&center, &outgoingIDs, &incomingID, nStreets]() {
+        center.queryStreets(incomingID, outgoingIDs);
+        doNotOptimize(outgoingIDs.data());
+        incomingID = (incomingID + 1) % nStreets;
+    }, 1);
+}
+BENCHMARK_REGISTER("IntersectionQueryStreets", IntersectionQueryStreets, {{2}, {4}, {8}, {32}});
+
+// items are routing decisions as taken by vehicles on the road graph : RoadGraphChoice/<streets at the intersection>
+void RoadGraphChoice(BenchmarkState &state)
+{
+    int nStreets = state.getArg(0);
+    World world;
+    createStarWorld(world, nStreets);
+
+    const RoadGraph &roadGraph = world.getRoadGraph();
+    RandomStream random(42, 0);
+    int incomingID = 0;
+    state.measure([&roadGraph, &random, &incomingID]() {
+        const RoadEdge &edge = roadGraph.getChoice(0, incomingID, random.uniformInt(roadGraph.getNumChoices(0)));
+        doNotOptimize(edge.streetID);
+        incomingID = edge.streetID;
+    }, 1);
+}
+BENCHMARK_REGISTER("RoadGraphChoice", RoadGraphChoice, {{2}, {4}, {8}, {32}});
+
+// writes the grid of createGridWorld as a city map in text form, with one vehicle per street
+void writeGridMap(const std::string &filename, int nSide)
+{
+    std::ofstream file(filename);
+    file << "scale 0.5\n";
+    for (int r = 0; r < nSide; r++)
+    {
+        for (int c = 0; c < nSide; c++)
+        {
+            file << "intersection " << 100 * c << " " << 100 * r << "\n";
+        }
+    }
+    int nStreets = 0;
+    for (int r = 0; r < nSide; r++)
+    {
+        for (int c = 0; c < nSide; c++)
+        {
+            if (c + 1 < nSide)
+            {
+                file << "street " << r * nSide + c << " " << r * nSide + c + 1 << "\n";
+                file << "spawn " << nStreets++ << " " << r * nSide + c + 1 << "\n";
+            }
+            if (r + 1 < nSide)
+            {
+                file << "street " << r * nSide + c << " " << (r + 1) * nSide + c << "\n";
+                file << "spawn " << nStreets++ << " " << (r + 1) * nSide + c << "\n";
+            }
+        }
+    }
+}
+
+// items are intersections loaded and built into a world, including streets and vehicles :
+// CityMapLoad/<form>/<grid side> with form 0 = text, 1 = binary
+void CityMapLoad(BenchmarkState &state)
+{
+    bool isBinary = state.getArg(0) == 1;
+    int nSide = state.getArg(1);
+    std::string filename = "citymap_bench.map";
+    writeGridMap(filename, nSide);
+    if (isBinary)
+    {
+        CityMap(filename).saveBinary(filename + "b");
+        filename += "b";
+    }
+
+    state.measure([&filename]() {
+        World world;
+        CityMap cityMap(filename);
+        cityMap.build(world);
+        doNotOptimize(world.getRoadGraph().getDegree(0));
+    }, nSide * nSide);
+    std::remove("citymap_bench.map");
+    std::remove("citymap_bench.mapb");
+}
+BENCHMARK_REGISTER("CityMapLoad", CityMapLoad, BenchmarkRegistry::argProduct({{0, 1}, {32, 320}}));
+
+// items are simulated runs of 10 s on a grid of 16 x 16 intersections with one vehicle per street :
+// BatchRuns/<runs>/<threads of the shared pool>
+void BatchRuns(BenchmarkState &state)
+{
+    int nRuns = state.getArg(0);
+    int nThreads = state.getArg(1);
+    std::string filename = "batch_bench.map";
+    writeGridMap(filename, 16);
+
+    // all runs share the map and differ in their seeds only
+    BatchRunner runner;
+    runner.setNumThreads(nThreads);
+    runner.setEndTime(10.0);
+    runner.setTickDuration(0.01);
+    for (int nr = 0; nr < nRuns; nr++)
+    {
+        runner.addRun(BatchRun{filename, -1, 0.0, 0.0, (uint64_t)nr});
+    }
+
+    state.measure([&runner]() {
+        runner.run();
+        doNotOptimize(runner.getResults().data());
+    }, nRuns);
+    std::remove("batch_bench.map");
+}
+BENCHMARK_REGISTER("BatchRuns", BatchRuns, BenchmarkRegistry::argProduct({{1, 16}, {1, 2, 4, 8}}));
+
+// items are vehicles copied into memory by a checkpoint, which is the pause the simulation sees :
+// CheckpointCapture/<vehicles>/<grid side>
+void CheckpointCapture(BenchmarkState &state)
+{
+    long nVehicles = state.getArg(0);
+    int nSide = state.getArg(1);
+    const double tickDuration = 0.01; // in s
+
+    World world;
+    world.setSeed(42);
+    createGridWorld(world, nSide, nVehicles);
+    Scheduler scheduler(world);
+    scheduler.setIsRealTime(false);
+    scheduler.setNumWorkers(1);
+    scheduler.setTickDuration(tickDuration);
+
+    // warm up until vehicles queue in front of intersections, so that the queues are part of the state
+    scheduler.setEndTime(249.5 * tickDuration);
+    scheduler.run();
+
+    Checkpoint checkpoint(world, scheduler, "checkpoint_bench.bin");
+    state.measure([&checkpoint]() {
+        checkpoint.capture();
+        doNotOptimize(checkpoint.getData().data());
+    }, nVehicles);
+    state.setCounter("bytes", checkpoint.getData().size());
+}
+BENCHMARK_REGISTER("CheckpointCapture", CheckpointCapture, BenchmarkRegistry::argProduct({{1000, 100000}, {32}}));
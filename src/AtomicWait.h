@@ -0,0 +1,49 @@
+#ifndef ATOMICWAIT_H
+#define ATOMICWAIT_H
+
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <thread>
+#include <chrono>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+// minimal stand-in for the C++20 std::atomic<T>::wait / notify API on a 32-bit word:
+// a futex on Linux and a short sleep-poll elsewhere. Waiters may wake up spuriously.
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex requires a plain 32-bit word");
+
+// blocks the calling thread as long as word still holds the value expected
+inline void atomicWait(std::atomic<uint32_t> &word, uint32_t expected)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    while (word.load() == expected)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+#endif
+}
+
+// wakes up one thread blocked in atomicWait on word
+inline void atomicNotifyOne(std::atomic<uint32_t> &word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+// wakes up all threads blocked in atomicWait on word
+inline void atomicNotifyAll(std::atomic<uint32_t> &word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+#endif
@@ -0,0 +1,289 @@
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "BatchRunner.h"
+#include "CityMap.h"
+#include "SignalController.h"
+#include "Scheduler.h"
+#include "World.h"
+
+/* Implementation of class "BatchRunner" */
+
+BatchRunner::BatchRunner()
+{
+    _endTime = 3600.0;
+    _tickDuration = 0.001;
+    _nThreads = std::max(1u, std::thread::hardware_concurrency());
+    _nextRun = 0;
+}
+
+void BatchRunner::loadSweep(const std::string &filename)
+{
+    std::vector<std::string> mapFilenames;
+    std::vector<long> vehicleCounts;
+    std::vector<double> signalCycles, greenWaveSpeeds;
+    std::vector<uint64_t> seeds;
+
+    // single pass over all lines, a keyword may be repeated to add more values
+    MappedFile file(filename);
+    const char *text = (const char *)file.getData();
+    const char *end = text + file.getSize();
+    int lineNumber = 0;
+    for (const char *line = text; line < end;)
+    {
+        const char *lineEnd = (const char *)std::memchr(line, '\n', end - line);
+        lineEnd = lineEnd ? lineEnd : end;
+        lineNumber++;
+
+        LineParser parser(line, lineEnd);
+        line = lineEnd + 1;
+        if (parser.isAtEnd())
+        {
+            continue;
+        }
+        std::string keyword = parser.getWord();
+        bool isValid = true;
+        if (keyword[0] == '#')
+        {
+            continue;
+        }
+        else if (keyword == "map")
+        {
+            while (!parser.isAtEnd())
+            {
+                mapFilenames.push_back(parser.getWord());
+            }
+        }
+        else if (keyword == "vehicles")
+        {
+            for (long nVehicles; isValid && !parser.isAtEnd();)
+            {
+                isValid = parser.get(nVehicles) && nVehicles >= 0;
+                vehicleCounts.push_back(nVehicles);
+            }
+        }
+        else if (keyword == "signal-cycle")
+        {
+            for (double signalCycle; isValid && !parser.isAtEnd();)
+            {
+                isValid = parser.get(signalCycle) && signalCycle >= 0.0 && std::isfinite(signalCycle);
+                signalCycles.push_back(signalCycle);
+            }
+        }
+        else if (keyword == "green-wave")
+        {
+            for (double greenWaveSpeed; isValid && !parser.isAtEnd();)
+            {
+                isValid = parser.get(greenWaveSpeed) && greenWaveSpeed >= 0.0 && std::isfinite(greenWaveSpeed);
+                greenWaveSpeeds.push_back(greenWaveSpeed);
+            }
+        }
+        else if (keyword == "seeds")
+        {
+            for (uint64_t seed; isValid && !parser.isAtEnd();)
+            {
+                isValid = parser.get(seed);
+                seeds.push_back(seed);
+            }
+        }
+        else if (keyword == "end")
+        {
+            isValid = parser.get(_endTime) && _endTime > 0.0 && std::isfinite(_endTime);
+        }
+        else if (keyword == "tick")
+        {
+            double tickDuration;
+            isValid = parser.get(tickDuration) && tickDuration > 0.0 && std::isfinite(tickDuration);
+            _tickDuration = tickDuration / 1000.0;
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        if (!isValid || !parser.isAtEnd())
+        {
+            throw std::runtime_error(filename + ":" + std::to_string(lineNumber) + ": malformed entry '" + keyword + "'");
+        }
+    }
+    if (mapFilenames.empty())
+    {
+        throw std::runtime_error(filename + ": sweep without a map");
+    }
+
+    // maps are given relative to the sweep file
+    size_t slash = filename.find_last_of('/');
+    for (std::string &mapFilename : mapFilenames)
+    {
+        if (mapFilename[0] != '/' && slash != std::string::npos)
+        {
+            mapFilename = filename.substr(0, slash + 1) + mapFilename;
+        }
+    }
+
+    // parameters which are not swept keep their defaults
+    if (vehicleCounts.empty())
+    {
+        vehicleCounts.push_back(-1);
+    }
+    if (signalCycles.empty())
+    {
+        signalCycles.push_back(0.0);
+    }
+    if (greenWaveSpeeds.empty())
+    {
+        greenWaveSpeeds.push_back(0.0);
+    }
+    if (seeds.empty())
+    {
+        seeds.push_back(1);
+    }
+    for (const std::string &mapFilename : mapFilenames)
+    {
+        for (long nVehicles : vehicleCounts)
+        {
+            for (double signalCycle : signalCycles)
+            {
+                for (double greenWaveSpeed : greenWaveSpeeds)
+                {
+                    for (uint64_t seed : seeds)
+                    {
+                        addRun(BatchRun{mapFilename, nVehicles, signalCycle, greenWaveSpeed, seed});
+                    }
+                }
+            }
+        }
+    }
+}
+
+void BatchRunner::addRun(const BatchRun &run)
+{
+    std::shared_ptr<CityMap> &cityMap = _cityMaps[run.mapFilename];
+    if (!cityMap)
+    {
+        cityMap = std::make_shared<CityMap>(run.mapFilename);
+    }
+    _runs.push_back(run);
+}
+
+void BatchRunner::run()
+{
+    // every thread of the pool takes the next run as soon as it has finished one, so that long and short runs balance out
+    _results.resize(_runs.size());
+    _nextRun = 0;
+    std::vector<std::thread> threads;
+    int nThreads = std::min<size_t>(_nThreads, _runs.size());
+    for (int t = 0; t < nThreads; t++)
+    {
+        threads.emplace_back(std::thread(&BatchRunner::runWorker, this));
+    }
+    std::for_each(threads.begin(), threads.end(), [](std::thread &t) {
+        t.join();
+    });
+}
+
+// function which is executed by every thread of the pool
+void BatchRunner::runWorker()
+{
+    for (size_t runIdx = _nextRun++; runIdx < _runs.size(); runIdx = _nextRun++)
+    {
+        // a failing run must neither end the pool nor the other runs, its error goes into its line of the CSV file
+        try
+        {
+            runSingle(runIdx);
+        }
+        catch (const std::exception &e)
+        {
+            _results[runIdx] = BatchResult();
+            _results[runIdx].error = e.what();
+        }
+    }
+}
+
+// builds the world of a run, simulates it on the calling thread and summarizes it
+void BatchRunner::runSingle(size_t runIdx)
+{
+    const BatchRun &run = _runs[runIdx];
+    BatchResult &result = _results[runIdx];
+    auto start = std::chrono::steady_clock::now();
+
+    World world;
+    world.setSeed(run.seed);
+    _cityMaps.at(run.mapFilename)->build(world, run.nVehicles);
+    if (run.signalCycle > 0.0 || run.greenWaveSpeed > 0.0)
+    {
+        // replace the random plans of all lights by coordinated ones
+        SignalController signalController(world);
+        if (run.signalCycle > 0.0)
+        {
+            signalController.setCycle(run.signalCycle);
+        }
+        if (run.greenWaveSpeed > 0.0)
+        {
+            signalController.setGreenWave(0, run.greenWaveSpeed);
+        }
+        signalController.apply();
+    }
+
+    Scheduler scheduler(world);
+    scheduler.setTickDuration(_tickDuration);
+    scheduler.setIsRealTime(false);
+    scheduler.setEndTime(_endTime);
+    scheduler.run();
+
+    result.simulationTime = scheduler.getSimulationTime();
+    result.nVehicles = world.getVehicles().size();
+    result.nAdmissions = 0;
+    result.maxQueueLength = 0;
+    int64_t totalEntryWait = 0;
+    for (auto &intersection : world.getIntersections())
+    {
+        result.nAdmissions += intersection->getNumAdmissions();
+        totalEntryWait += intersection->getTotalEntryWait();
+        result.maxQueueLength = std::max(result.maxQueueLength, intersection->getMaxQueueLength());
+    }
+    result.meanEntryWait = result.nAdmissions > 0 ? totalEntryWait * 1e-9 / result.nAdmissions : 0.0;
+    double speedSum = 0.0;
+    for (auto &vehicle : world.getVehicles())
+    {
+        speedSum += vehicle->getSpeed();
+    }
+    result.meanSpeed = result.nVehicles > 0 ? speedSum / result.nVehicles : 0.0;
+    result.checksum = world.getChecksum();
+    result.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// encloses a field in double quotes and doubles the quotes within it, see RFC 4180
+static std::string quoteCsv(const std::string &field)
+{
+    std::string quoted = "\"";
+    for (char c : field)
+    {
+        quoted += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+size_t BatchRunner::getNumFailedRuns()
+{
+    return std::count_if(_results.begin(), _results.end(), [](const BatchResult &result) {
+        return !result.error.empty();
+    });
+}
+
+void BatchRunner::writeCsv(std::ostream &out)
+{
+    out << "run,map,vehicles,signal_cycle,green_wave,seed,simulated_time,wall_time,admissions,mean_entry_wait,mean_speed,max_queue_length,checksum,error\n";
+    for (size_t runIdx = 0; runIdx < _runs.size() && runIdx < _results.size(); runIdx++)
+    {
+        const BatchRun &run = _runs[runIdx];
+        const BatchResult &result = _results[runIdx];
+        out << runIdx << "," << quoteCsv(run.mapFilename) << "," << result.nVehicles << "," << run.signalCycle << "," << run.greenWaveSpeed << ","
+            << run.seed << "," << result.simulationTime << "," << result.wallTime << "," << result.nAdmissions << ","
+            << result.meanEntryWait << "," << result.meanSpeed << "," << result.maxQueueLength << ","
+            << std::hex << result.checksum << std::dec << "," << quoteCsv(result.error) << "\n";
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <ostream>
+#include <cstdint>
+
+// forward declarations to avoid include cycle
+class CityMap;
+
+// auxiliary struct holding the parameters of a single run of a sweep
+struct BatchRun
+{
+    std::string mapFilename;
+    long nVehicles;        // distributed over the spawns of the map, -1 for the vehicles of the map
+    double signalCycle;    // common cycle of all lights in s, 0 keeps the random plans
+    double greenWaveSpeed; // in m/s, 0 for no green wave
+    uint64_t seed;
+};
+
+// auxiliary struct holding the summary of a finished run
+struct BatchResult
+{
+    double simulationTime;   // in s
+    double wallTime;         // in s
+    long nVehicles;
+    uint64_t nAdmissions;    // summed over all intersections
+    double meanEntryWait;    // in simulated s per admission
+    double meanSpeed;        // over all vehicles at the end of the run, in m/s
+    int maxQueueLength;      // longest queue of a single approach of any intersection
+    uint64_t checksum;       // see World::getChecksum
+    std::string error;       // empty unless the run has failed, the other values are zero then
+};
+
+// runs the combinations of a parameter sweep as independent headless simulations on a shared pool of threads.
+// Every thread advances one simulation at a time on a single-worker Scheduler, so that runs never wait for each
+// other, and all runs of a map share its CityMap and road graph, which are read-only.
+//
+// A sweep file has one entry per line, every line may list any number of values:
+//   map <file> ...           city maps, relative to the sweep file
+//   vehicles <n> ...         vehicles per run (default: as placed by the map)
+//   signal-cycle <s> ...     common cycle of all lights, 0 for random plans (default: 0)
+//   green-wave <m/s> ...     speed of a green wave from intersection 0, 0 for none (default: 0)
+//   seeds <n> ...            seeds of the random streams (default: 1)
+//   end <s>                  simulated time of every run (default: 3600)
+//   tick <ms>                duration of an engine tick (default: 1)
+// Every combination of the values is one run. Empty lines and lines starting with '#' are ignored, negative or
+// non-finite values are rejected as malformed entries.
+class BatchRunner
+{
+public:
+    // constructor / desctructor
+    BatchRunner();
+
+    // getters / setters
+    void setNumThreads(int nThreads) { _nThreads = nThreads; }
+    void setEndTime(double endTime) { _endTime = endTime; }                // in s
+    void setTickDuration(double tickDuration) { _tickDuration = tickDuration; } // in s
+    const std::vector<BatchRun> &getRuns() { return _runs; }
+    const std::vector<BatchResult> &getResults() { return _results; }
+
+    // typical behaviour methods
+    void loadSweep(const std::string &filename); // adds all combinations of a sweep file, throws on malformed files
+    void addRun(const BatchRun &run);            // loads its map unless another run uses it already
+    void run();                                  // blocks until all runs have finished
+    void writeCsv(std::ostream &out);            // one line per run, in the order in which the runs were added
+    size_t getNumFailedRuns();                   // runs whose result holds an error
+
+private:
+    // typical behaviour methods
+    void runWorker();
+    void runSingle(size_t runIdx);
+
+    std::vector<BatchRun> _runs;
+    std::vector<BatchResult> _results;                          // indexed like _runs
+    std::map<std::string, std::shared_ptr<CityMap>> _cityMaps; // every map is loaded once and shared by its runs
+    double _endTime;                                            // simulated time of every run in s
+    double _tickDuration;                                       // in s
+    int _nThreads;                                              // size of the pool, one thread per hardware core by default
+    std::atomic<size_t> _nextRun;                               // next run to be taken by a thread of the pool
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include "Checkpoint.h"
+#include "TrajectoryFormat.h"
+#include "MappedFile.h"
+#include "Scheduler.h"
+#include "World.h"
+#include "Logger.h"
+
+const char checkpointMagic[4] = {'C', 'K', 'P', '2'};
+const char checkpointEndMagic[4] = {'C', 'K', 'P', 'E'};
+const size_t checkpointHeaderSize = 48;
+
+/* Implementation of class "Checkpoint" */
+
+Checkpoint::Checkpoint(World &world, Scheduler &scheduler, const std::string &filename) : _world(world), _scheduler(scheduler)
+{
+    _filename = filename;
+    _isWriting = false;
+    _tick = -1;
+}
+
+Checkpoint::~Checkpoint()
+{
+    finish();
+}
+
+// called while all workers wait at the barrier, so it must not wait for the previous state to be written
+bool Checkpoint::save()
+{
+    if (_isWriting)
+    {
+        LOG_WARNING("Checkpoint: skipped tick {}, the previous checkpoint is still being written", _scheduler.getTickCount());
+        return false;
+    }
+    finish(); // the writer has finished already, joining it returns at once
+    capture();
+    _isWriting = true;
+    _writer = std::thread(&Checkpoint::write, this);
+    return true;
+}
+
+void Checkpoint::finish()
+{
+    if (_writer.joinable())
+    {
+        _writer.join();
+    }
+}
+
+// must be called between two ticks, the buffer keeps its capacity, so that capturing allocates nothing after the first time
+void Checkpoint::capture()
+{
+    _data.assign(checkpointMagic, checkpointMagic + 4);
+    ByteWriter writer(_data);
+    writer.put<uint64_t>(_world.getSeed());
+    writer.put<double>(_scheduler.getTickDuration());
+    writer.put<int64_t>(_scheduler.getTickCount());
+    writer.put<uint32_t>(_world.getIntersections().size());
+    writer.put<uint32_t>(_world.getStreets().size());
+    writer.put<uint32_t>(_world.getVehicles().size());
+    writer.put<uint64_t>(_world.getMapFingerprint());
+
+    for (auto &intersection : _world.getIntersections())
+    {
+        intersection->saveState(writer);
+    }
+
+    _scheduler.getVehicleOrder(_vehicleIDs);
+    for (int vehicleID : _vehicleIDs)
+    {
+        writer.putVarint(vehicleID);
+    }
+    for (int vehicleID : _vehicleIDs)
+    {
+        _world.getVehicle(vehicleID).saveState(writer);
+    }
+    for (int vehicleID : _vehicleIDs)
+    {
+        _world.getVehicle(vehicleID).saveMotion(writer);
+    }
+
+    for (auto &street : _world.getStreets())
+    {
+        for (int destinationID : {street->getOutIntersectionID(), street->getInIntersectionID()})
+        {
+            for (int lane = 0; lane < street->getNumLanes(); lane++)
+            {
+                Lane &vehicles = street->getLane(destinationID, lane);
+                writer.putVarint(vehicles.getSize());
+                for (int i = 0; i < vehicles.getSize(); i++)
+                {
+                    writer.putVarint(vehicles.getVehicle(i));
+                }
+            }
+        }
+    }
+    writer.putBytes(checkpointEndMagic, 4);
+    _tick = _scheduler.getTickCount();
+}
+
+// writes into a temporary file first, so that a crash while writing leaves the previous checkpoint intact
+void Checkpoint::write()
+{
+    std::string tmpFilename = _filename + ".tmp";
+    bool isWritten;
+    {
+        std::ofstream out(tmpFilename, std::ios::binary | std::ios::trunc);
+        out.write((const char *)_data.data(), _data.size());
+        out.flush();
+        isWritten = (bool)out;
+    }
+    if (!isWritten || std::rename(tmpFilename.c_str(), _filename.c_str()) != 0)
+    {
+        LOG_ERROR("Checkpoint: cannot write the checkpoint of tick {}", _tick);
+    }
+    _isWriting = false;
+}
+
+void Checkpoint::restore()
+{
+    MappedFile file(_filename);
+    const uint8_t *data = file.getData();
+    size_t size = file.getSize();
+    ByteReader reader(data, data + size);
+    if (size < checkpointHeaderSize + 4 || !reader.getMagic(checkpointMagic) ||
+        !ByteReader(data + size - 4, data + size).getMagic(checkpointEndMagic))
+    {
+        throw std::runtime_error(_filename + " is not a complete checkpoint");
+    }
+    uint64_t seed = reader.get<uint64_t>();
+    double tickDuration = reader.get<double>();
+    long tick = reader.get<int64_t>();
+    size_t nIntersections = reader.get<uint32_t>();
+    size_t nStreets = reader.get<uint32_t>();
+    size_t nVehicles = reader.get<uint32_t>();
+    uint64_t mapFingerprint = reader.get<uint64_t>();
+    if (nIntersections != _world.getIntersections().size() || nStreets != _world.getStreets().size() ||
+        nVehicles != _world.getVehicles().size() || mapFingerprint != _world.getMapFingerprint())
+    {
+        throw std::runtime_error(_filename + " has been saved from another map or number of vehicles");
+    }
+    if (tickDuration != _scheduler.getTickDuration())
+    {
+        throw std::runtime_error(_filename + " has been saved with a tick of " + std::to_string(tickDuration * 1000.0) + " ms");
+    }
+    if (tick < 0)
+    {
+        throw std::runtime_error(_filename + " is corrupt");
+    }
+
+    // the reader throws on any count or id which does not fit the data or the map, the world is unusable afterwards
+    try
+    {
+        restoreState(ByteReader(reader.getPosition(), data + size - 4), tick);
+    }
+    catch (const std::runtime_error &e)
+    {
+        throw std::runtime_error(_filename + " is corrupt : " + e.what());
+    }
+    _world.setSeed(seed);
+    _tick = tick;
+}
+
+// reads everything between the header and the end magic
+void Checkpoint::restoreState(ByteReader reader, long tick)
+{
+    // intersections first, so that the scheduler finds their pending wake-ups
+    for (auto &intersection : _world.getIntersections())
+    {
+        intersection->restoreState(reader, _world);
+    }
+
+    // every vehicle is attached exactly once and sits in exactly one lane
+    size_t nVehicles = _world.getVehicles().size();
+    std::vector<int> vehicleIDs(nVehicles);
+    std::vector<bool> isListed(nVehicles, false);
+    for (int &vehicleID : vehicleIDs)
+    {
+        vehicleID = ByteReader::checkID(reader.getVarint(), nVehicles);
+        if (isListed[vehicleID])
+        {
+            throw std::runtime_error("vehicle #" + std::to_string(vehicleID) + " is listed twice");
+        }
+        isListed[vehicleID] = true;
+    }
+    for (int vehicleID : vehicleIDs)
+    {
+        _world.getVehicle(vehicleID).restoreState(reader);
+    }
+    _scheduler.restore(tick, vehicleIDs);
+    for (int vehicleID : vehicleIDs)
+    {
+        _world.getVehicle(vehicleID).restoreMotion(reader);
+    }
+
+    for (auto &street : _world.getStreets())
+    {
+        for (int destinationID : {street->getOutIntersectionID(), street->getInIntersectionID()})
+        {
+            for (int lane = 0; lane < street->getNumLanes(); lane++)
+            {
+                for (size_t n = reader.getCount(1); n > 0; n--)
+                {
+                    Vehicle &vehicle = _world.getVehicle(ByteReader::checkID(reader.getVarint(), nVehicles));
+                    if (vehicle.isInLane() || vehicle.getCurrentStreetID() != street->getID() ||
+                        vehicle.getCurrentDestinationID() != destinationID)
+                    {
+                        throw std::runtime_error("vehicle #" + std::to_string(vehicle.getID()) + " is in a wrong lane");
+                    }
+                    vehicle.enterLane(lane);
+                }
+            }
+        }
+    }
+    for (auto &vehicle : _world.getVehicles())
+    {
+        if (!vehicle->isInLane())
+        {
+            throw std::runtime_error("vehicle #" + std::to_string(vehicle->getID()) + " is in no lane");
+        }
+    }
+    if (!reader.isAtEnd())
+    {
+        throw std::runtime_error("unexpected data after the lanes");
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+// forward declarations to avoid include cycle
+class World;
+class Scheduler;
+class ByteReader;
+
+// saves the complete state of an engine run into a compact binary file and continues a run from it, so that long
+// runs survive restarts and experiments can start from a congested network instead of an empty one.
+//
+//   header       : "CKP2", seed (u64), tick duration (f64), tick (i64), #intersections, #streets, #vehicles (u32),
+//                  fingerprint of the map (u64, see World::getMapFingerprint)
+//   intersections: signal plan, pending wake-up, counters, the queue of every approach and the crossing vehicles
+//   vehicles     : ids in the order of the rows of the scheduler (varint), followed by the state of every vehicle in
+//                  that order (street, destination, chosen exit, random stream, handshake flags), then its motion state
+//   lanes        : for every lane of every street, its vehicles from front to back
+//   footer       : "CKPE"
+//
+// Doubles are stored bit for bit and the rows keep their order, so that a restored run continues exactly like the
+// saved one, with any number of workers. Every count and id is checked against the map and the size of the file.
+// A checkpoint is only taken between two ticks, from a frame callback, where all workers wait at the barrier : the
+// state is copied into memory, which takes about 0.1 µs per vehicle, and written to the file on a thread of its own
+// while the simulation goes on. The workers never wait for that thread, a checkpoint is skipped while it is busy.
+class Checkpoint
+{
+public:
+    // constructor / desctructor
+    Checkpoint(World &world, Scheduler &scheduler, const std::string &filename);
+    ~Checkpoint();
+
+    // getters / setters
+    long getTick() { return _tick; } // tick of the latest saved state, -1 for none
+    const std::vector<uint8_t> &getData() { return _data; }
+
+    // typical behaviour methods
+    bool save();    // captures the current state and writes it in the background, replacing the file atomically, false if skipped
+    void capture(); // copies the current state into getData() without writing it, not while a save is being written
+    void finish();  // blocks until the latest state has been written
+    void restore(); // continues from the file, before the scheduler is started, throws if the file does not fit the world
+
+private:
+    // typical behaviour methods
+    void write();
+    void restoreState(ByteReader reader, long tick);
+
+    World &_world;
+    Scheduler &_scheduler;
+    std::string _filename;
+    std::vector<uint8_t> _data;   // latest captured state, owned by the writer thread until it has finished
+    std::vector<int> _vehicleIDs; // scratch space for the order of the rows, kept to avoid reallocation
+    std::thread _writer;          // writes _data into a temporary file and renames it
+    std::atomic<bool> _isWriting; // set until the writer has finished, so that it can be polled without joining it
+    long _tick;
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include "World.h"
+#include "CityMap.h"
+
+static const char cityMapMagic[4] = {'C', 'M', 'P', '2'};
+static const char outdatedCityMapMagic[4] = {'C', 'M', 'A', 'P'}; // streets without lanes
+
+/* Implementation of class "CityMap" */
+
+CityMap::CityMap(const std::string &filename) : _file(new MappedFile(filename))
+{
+    _filename = filename;
+    const uint8_t *data = _file->getData();
+    size_t size = _file->getSize();
+    if (size >= 4 && std::memcmp(data, cityMapMagic, 4) == 0)
+    {
+        parseBinary(data, size);
+    }
+    else if (size >= 4 && std::memcmp(data, outdatedCityMapMagic, 4) == 0)
+    {
+        throw std::runtime_error(filename + ": outdated binary city map, convert the text form again with --save-map");
+    }
+    else
+    {
+        parseText((const char *)data, size);
+        _file.reset(); // everything has been copied out of the text
+    }
+    validate();
+
+    // the background image is given relative to the map file
+    size_t slash = filename.find_last_of('/');
+    if (!_bgFilename.empty() && _bgFilename[0] != '/' && slash != std::string::npos)
+    {
+        _bgFilename = filename.substr(0, slash + 1) + _bgFilename;
+    }
+}
+
+size_t CityMap::getNumVehicles()
+{
+    size_t nVehicles = 0;
+    for (size_t ns = 0; ns < _nSpawns; ns++)
+    {
+        nVehicles += _spawns[ns].count;
+    }
+    return nVehicles;
+}
+
+void CityMap::parseText(const char *text, size_t size)
+{
+    // single pass over all lines, appending to the arrays which are later built in bulk
+    double scale = 0.0;
+    int32_t nLanes = 1;
+    std::vector<bool> hasLength;
+    const char *end = text + size;
+    int lineNumber = 0;
+    for (const char *line = text; line < end;)
+    {
+        const char *lineEnd = (const char *)std::memchr(line, '\n', end - line);
+        lineEnd = lineEnd ? lineEnd : end;
+        lineNumber++;
+
+        LineParser parser(line, lineEnd);
+        line = lineEnd + 1;
+        if (parser.isAtEnd())
+        {
+            continue;
+        }
+        std::string keyword = parser.getWord();
+        bool isValid = true;
+        if (keyword[0] == '#')
+        {
+            continue;
+        }
+        else if (keyword == "intersection")
+        {
+            double x, y;
+            isValid = parser.get(x) && parser.get(y);
+            _ownPositions.push_back(x);
+            _ownPositions.push_back(y);
+        }
+        else if (keyword == "street")
+        {
+            MapStreet street{-1, -1, 1000.0, nLanes, 0};
+            isValid = parser.get(street.inID) && parser.get(street.outID);
+            hasLength.push_back(!parser.isAtEnd());
+            isValid = isValid && (!hasLength.back() || parser.get(street.length));
+            _ownStreets.push_back(street);
+        }
+        else if (keyword == "spawn")
+        {
+            MapSpawn spawn{-1, -1, 1};
+            isValid = parser.get(spawn.streetID) && parser.get(spawn.destinationID) && (parser.isAtEnd() || parser.get(spawn.count));
+            _ownSpawns.push_back(spawn);
+        }
+        else if (keyword == "background")
+        {
+            _bgFilename = parser.getWord();
+        }
+        else if (keyword == "scale")
+        {
+            isValid = parser.get(scale);
+        }
+        else if (keyword == "lanes")
+        {
+            isValid = parser.get(nLanes);
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        if (!isValid || !parser.isAtEnd())
+        {
+            throw std::runtime_error(_filename + ":" + std::to_string(lineNumber) + ": malformed entry '" + keyword + "'");
+        }
+    }
+
+    _nIntersections = _ownPositions.size() / 2;
+    _nStreets = _ownStreets.size();
+    _nSpawns = _ownSpawns.size();
+    _positions = _ownPositions.data();
+    _streets = _ownStreets.data();
+    _spawns = _ownSpawns.data();
+
+    // streets without a length are measured on the map, once all intersections are known
+    for (size_t ns = 0; ns < _nStreets && scale > 0.0; ns++)
+    {
+        MapStreet &street = _ownStreets[ns];
+        if (!hasLength[ns] && street.inID >= 0 && street.inID < (int)_nIntersections && street.outID >= 0 && street.outID < (int)_nIntersections)
+        {
+            double dx = _positions[2 * street.outID] - _positions[2 * street.inID];
+            double dy = _positions[2 * street.outID + 1] - _positions[2 * street.inID + 1];
+            street.length = scale * std::sqrt(dx * dx + dy * dy);
+        }
+    }
+}
+
+void CityMap::parseBinary(const uint8_t *data, size_t size)
+{
+    // the arrays are used in place, only the section boundaries are computed
+    uint32_t header[4];
+    if (size < 4 + sizeof(header))
+    {
+        throw std::runtime_error(_filename + ": truncated city map");
+    }
+    std::memcpy(header, data + 4, sizeof(header));
+    _nIntersections = header[0];
+    _nStreets = header[1];
+    _nSpawns = header[2];
+    size_t bgLength = header[3];
+
+    size_t offset = 4 + sizeof(header);
+    size_t positionsOffset = (offset + bgLength + 7) & ~(size_t)7;
+    size_t streetsOffset = positionsOffset + 2 * sizeof(double) * _nIntersections;
+    size_t spawnsOffset = streetsOffset + sizeof(MapStreet) * _nStreets;
+    if (size < spawnsOffset + sizeof(MapSpawn) * _nSpawns)
+    {
+        throw std::runtime_error(_filename + ": truncated city map");
+    }
+    _bgFilename.assign((const char *)data + offset, bgLength);
+    _positions = (const double *)(data + positionsOffset);
+    _streets = (const MapStreet *)(data + streetsOffset);
+    _spawns = (const MapSpawn *)(data + spawnsOffset);
+}
+
+// checks all references between entries, so that building cannot fail halfway
+void CityMap::validate()
+{
+    for (size_t ns = 0; ns < _nStreets; ns++)
+    {
+        const MapStreet &street = _streets[ns];
+        if (street.inID < 0 || street.inID >= (int)_nIntersections || street.outID < 0 || street.outID >= (int)_nIntersections || !(street.length > 0.0) || street.nLanes < 1)
+        {
+            throw std::runtime_error(_filename + ": street " + std::to_string(ns) + " has unknown intersections, no length or no lanes");
+        }
+    }
+    for (size_t ns = 0; ns < _nSpawns; ns++)
+    {
+        const MapSpawn &spawn = _spawns[ns];
+        if (spawn.streetID < 0 || spawn.streetID >= (int)_nStreets ||
+            (spawn.destinationID != _streets[spawn.streetID].inID && spawn.destinationID != _streets[spawn.streetID].outID))
+        {
+            throw std::runtime_error(_filename + ": spawn " + std::to_string(ns) + " has an unknown street or a destination not on its street");
+        }
+    }
+}
+
+void CityMap::build(World &world, long nVehicles)
+{
+    world.reserve(world.getIntersections().size() + _nIntersections, world.getStreets().size() + _nStreets,
+                  world.getVehicles().size() + (nVehicles >= 0 ? nVehicles : getNumVehicles()));
+
+    // size the street list of every intersection in advance
+    std::vector<int> degrees(_nIntersections, 0);
+    for (size_t ns = 0; ns < _nStreets; ns++)
+    {
+        degrees[_streets[ns].inID]++;
+        degrees[_streets[ns].outID]++;
+    }
+    size_t idOffset = world.getIntersections().size();
+    for (size_t ni = 0; ni < _nIntersections; ni++)
+    {
+        std::shared_ptr<Intersection> intersection = world.addIntersection();
+        intersection->setPosition(_positions[2 * ni], _positions[2 * ni + 1]);
+        intersection->reserveStreets(degrees[ni]);
+    }
+
+    size_t streetOffset = world.getStreets().size();
+    for (size_t ns = 0; ns < _nStreets; ns++)
+    {
+        std::shared_ptr<Street> street = world.addStreet();
+        street->setLength(_streets[ns].length);
+        street->setNumLanes(_streets[ns].nLanes);
+        street->setInIntersection(world.getIntersection(idOffset + _streets[ns].inID));
+        street->setOutIntersection(world.getIntersection(idOffset + _streets[ns].outID));
+    }
+
+    // a given number of vehicles is distributed round-robin over the spawns, e.g. for sweeps over the traffic volume
+    auto spawnVehicle = [&world, idOffset, streetOffset](const MapSpawn &spawn) {
+        std::shared_ptr<Vehicle> vehicle = world.addVehicle();
+        vehicle->setCurrentStreet(world.getStreet(streetOffset + spawn.streetID));
+        vehicle->setCurrentDestination(world.getIntersection(idOffset + spawn.destinationID));
+    };
+    if (nVehicles < 0)
+    {
+        for (size_t ns = 0; ns < _nSpawns; ns++)
+        {
+            for (uint32_t nv = 0; nv < _spawns[ns].count; nv++)
+            {
+                spawnVehicle(_spawns[ns]);
+            }
+        }
+    }
+    else if (_nSpawns > 0)
+    {
+        for (long nv = 0; nv < nVehicles; nv++)
+        {
+            spawnVehicle(_spawns[nv % _nSpawns]);
+        }
+    }
+
+    // the road graph does not depend on the vehicles, so all worlds holding nothing but this map share one
+    if (idOffset != 0 || streetOffset != 0)
+    {
+        world.buildRoadGraph();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_roadGraphMutex);
+    if (_roadGraph)
+    {
+        world.setRoadGraph(_roadGraph);
+    }
+    else
+    {
+        world.buildRoadGraph();
+        _roadGraph = world.getSharedRoadGraph();
+    }
+}
+
+void CityMap::saveBinary(const std::string &filename)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+
+    // the background is stored as given in the map file, i.e. relative to the map file
+    std::string bgFilename = _bgFilename;
+    size_t slash = _filename.find_last_of('/');
+    if (slash != std::string::npos && bgFilename.compare(0, slash + 1, _filename, 0, slash + 1) == 0)
+    {
+        bgFilename = bgFilename.substr(slash + 1);
+    }
+
+    uint32_t header[4] = {(uint32_t)_nIntersections, (uint32_t)_nStreets, (uint32_t)_nSpawns, (uint32_t)bgFilename.size()};
+    file.write(cityMapMagic, 4);
+    file.write((const char *)header, sizeof(header));
+    file.write(bgFilename.data(), bgFilename.size());
+    size_t offset = 4 + sizeof(header) + bgFilename.size();
+    const char padding[8] = {0};
+    file.write(padding, ((offset + 7) & ~(size_t)7) - offset);
+    file.write((const char *)_positions, 2 * sizeof(double) * _nIntersections);
+    file.write((const char *)_streets, sizeof(MapStreet) * _nStreets);
+    file.write((const char *)_spawns, sizeof(MapSpawn) * _nSpawns);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot write " + filename);
+    }
+}
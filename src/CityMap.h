@@ -0,0 +1,137 @@
+#ifndef CITYMAP_H
+#define CITYMAP_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <charconv>
+#include "MappedFile.h"
+
+// forward declarations to avoid include cycle
+class World;
+class RoadGraph;
+
+// street of a city map, lengths in m
+struct MapStreet
+{
+    int32_t inID;   // intersection at which the street starts
+    int32_t outID;  // intersection at which the street ends
+    double length;  // length of the street in m
+    int32_t nLanes; // number of lanes in each driving direction
+    int32_t unused; // keeps the binary form free of implicit padding
+};
+
+// vehicles placed on a street at the start of a simulation
+struct MapSpawn
+{
+    int32_t streetID;      // street the vehicles start on
+    int32_t destinationID; // intersection the vehicles drive to first, one end of the street
+    uint32_t count;        // number of vehicles
+};
+
+// cursor over a single line of the text form, which is not null-terminated within the mapped file
+class LineParser
+{
+public:
+    // constructor / desctructor
+    LineParser(const char *begin, const char *end) : _pos(begin), _end(end) {}
+
+    // typical behaviour methods
+    bool isAtEnd()
+    {
+        skipSpaces();
+        return _pos >= _end;
+    }
+
+    std::string getWord()
+    {
+        skipSpaces();
+        const char *begin = _pos;
+        while (_pos < _end && *_pos != ' ' && *_pos != '\t')
+        {
+            _pos++;
+        }
+        return std::string(begin, _pos);
+    }
+
+    template <class T>
+    bool get(T &value)
+    {
+        skipSpaces();
+        std::from_chars_result result = std::from_chars(_pos, _end, value);
+        if (result.ec != std::errc() || (result.ptr < _end && *result.ptr != ' ' && *result.ptr != '\t'))
+        {
+            return false;
+        }
+        _pos = result.ptr;
+        return true;
+    }
+
+private:
+    void skipSpaces()
+    {
+        while (_pos < _end && (*_pos == ' ' || *_pos == '\t' || *_pos == '\r'))
+        {
+            _pos++;
+        }
+    }
+
+    const char *_pos;
+    const char *_end;
+};
+
+// road network, background image and initial vehicles of a simulation, loaded from a file in one of two forms.
+//
+// The text form has one entry per line, ids are implicit and count from 0 in order of appearance:
+//   background <image>           background image, relative to the map file
+//   scale <m>                    meters per pixel, used for streets without a length (default: none, 1000 m per street)
+//   lanes <n>                    lanes per driving direction of all following streets (default: 1)
+//   intersection <x> <y>         pixel position of the next intersection
+//   street <in> <out> [<length>] next street between two intersections, length in m
+//   spawn <street> <destination> [<count>]
+// Empty lines and lines starting with '#' are ignored.
+//
+// Building is read-only, so any number of worlds may be built from one map concurrently.
+//
+// The binary form is an image of the arrays below, so that it is memory-mapped and used in place without parsing:
+//   "CMP2", #intersections (u32), #streets (u32), #spawns (u32), background length (u32), background, padding to 8 bytes,
+//   x, y (f64) of every intersection, MapStreet of every street, MapSpawn of every spawn (native byte order)
+class CityMap
+{
+public:
+    // constructor / desctructor
+    CityMap(const std::string &filename); // detects the form by its magic, throws on malformed files
+
+    // getters / setters
+    const std::string &getBackgroundFilename() { return _bgFilename; }
+    size_t getNumIntersections() { return _nIntersections; }
+    size_t getNumStreets() { return _nStreets; }
+    size_t getNumVehicles();
+
+    // typical behaviour methods
+    void build(World &world, long nVehicles = -1); // creates and connects all objects, nVehicles >= 0 replaces the counts of the spawns
+    void saveBinary(const std::string &filename); // writes the binary form, which loads much faster than the text
+
+private:
+    // typical behaviour methods
+    void parseText(const char *text, size_t size);
+    void parseBinary(const uint8_t *data, size_t size);
+    void validate();
+
+    std::unique_ptr<MappedFile> _file; // mapped file, the binary form is used in place
+    std::string _filename;
+    std::string _bgFilename;           // background image, resolved relative to the map file
+    size_t _nIntersections, _nStreets, _nSpawns;
+    const double *_positions;          // x, y of every intersection
+    const MapStreet *_streets;         // all streets
+    const MapSpawn *_spawns;           // all spawns
+    std::vector<double> _ownPositions; // parsed text form, the pointers above refer to these
+    std::vector<MapStreet> _ownStreets;
+    std::vector<MapSpawn> _ownSpawns;
+    std::shared_ptr<const RoadGraph> _roadGraph; // shared by all worlds built from this map alone
+    std::mutex _roadGraphMutex;                  // worlds may be built concurrently, e.g. by a BatchRunner
+};
+
+#endif
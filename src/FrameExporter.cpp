@@ -0,0 +1,120 @@
+#include <stdexcept>
+#include <cctype>
+#include <cstdio>
+#include <vector>
+#include <opencv2/imgcodecs.hpp>
+#include "World.h"
+#include "FrameExporter.h"
+
+/* Implementation of class "FrameExporter" */
+
+FrameExporter::FrameExporter(const std::string &bgFilename, const std::string &outFilename, double fps, ExportPolicy policy, size_t queueCapacity)
+    : _frames(queueCapacity)
+{
+    _outFilename = outFilename;
+    _policy = policy;
+    _nAdded = 0;
+    _nWritten = 0;
+    _nDropped = 0;
+
+    // downscale the background once, frames are composed at display size
+    _graphics.setBgFilename(bgFilename);
+    _graphics.loadBackgroundImg();
+
+    // a file name with a single integer conversion such as frame_%05d.png selects an image sequence
+    size_t percent = outFilename.find('%');
+    _isImageSequence = percent != std::string::npos;
+    if (_isImageSequence)
+    {
+        size_t conversion = percent + 1;
+        while (conversion < outFilename.size() && std::isdigit(outFilename[conversion]))
+        {
+            conversion++;
+        }
+        if (conversion >= outFilename.size() || outFilename[conversion] != 'd' || outFilename.find('%', conversion) != std::string::npos)
+        {
+            throw std::invalid_argument("Image sequence pattern must contain a single %d conversion: " + outFilename);
+        }
+    }
+    else
+    {
+        // pick a codec which ships with OpenCV for the file type
+        std::string extension = outFilename.substr(outFilename.find_last_of('.') + 1);
+        int fourcc = extension == "mp4" ? cv::VideoWriter::fourcc('m', 'p', '4', 'v') : cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        _writer.open(outFilename, fourcc, fps, _graphics.getFrameSize(), true);
+        if (!_writer.isOpened())
+        {
+            throw std::runtime_error("Cannot open video file " + outFilename);
+        }
+    }
+
+    // launch the encoder stage
+    _encoder = std::thread(&FrameExporter::encode, this);
+}
+
+FrameExporter::~FrameExporter()
+{
+    finish();
+}
+
+void FrameExporter::addFrame(World &world, double simulationTime)
+{
+    // take the snapshot on the calling thread, where the state of the world is consistent
+    world.writeSnapshot(_nextFrame, simulationTime);
+    queueNextFrame();
+}
+
+void FrameExporter::queueNextFrame()
+{
+    _nextFrame.sequence = _nAdded++;
+
+    if (_policy == ExportPolicy::blockSimulation)
+    {
+        _frames.send(std::move(_nextFrame));
+    }
+    else if (!_frames.trySend(_nextFrame))
+    {
+        _nDropped++;
+    }
+}
+
+void FrameExporter::finish()
+{
+    if (!_encoder.joinable())
+    {
+        return;
+    }
+
+    // a negative sequence number tells the encoder that no more frames will follow
+    Snapshot endOfStream;
+    endOfStream.sequence = -1;
+    _frames.send(std::move(endOfStream));
+    _encoder.join();
+    _writer.release();
+}
+
+// function which is executed in a thread
+void FrameExporter::encode()
+{
+    std::vector<char> filename(_outFilename.size() + 32);
+    while (true)
+    {
+        Snapshot snapshot = _frames.receive();
+        if (snapshot.sequence < 0)
+        {
+            break;
+        }
+
+        const cv::Mat &frame = _graphics.renderFrame(snapshot);
+        if (_isImageSequence)
+        {
+            std::snprintf(filename.data(), filename.size(), _outFilename.c_str(), (int)_nWritten);
+            cv::imwrite(filename.data(), frame);
+        }
+        else
+        {
+            _writer.write(frame);
+        }
+        _nWritten++;
+    }
+}
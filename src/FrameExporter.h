@@ -0,0 +1,60 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include "MessageQueue.h"
+#include "Snapshot.h"
+#include "Graphics.h"
+
+// forward declarations to avoid include cycle
+class World;
+
+// behaviour of addFrame when the encoder lags behind and the frame queue is full
+enum ExportPolicy
+{
+    dropFrames,      // discard the new frame, the simulation never waits for the encoder
+    blockSimulation, // wait for a free slot, so that every frame is written
+};
+
+// renders snapshots into a video file or a numbered PNG sequence without opening a window.
+// Snapshots are taken on the simulation thread and handed to an encoder thread through a
+// bounded queue, so rendering and encoding run in a pipeline stage of their own.
+class FrameExporter
+{
+public:
+    // constructor / desctructor
+    FrameExporter(const std::string &bgFilename, const std::string &outFilename, double fps, ExportPolicy policy, size_t queueCapacity = 64);
+    ~FrameExporter();
+
+    // getters / setters
+    long getNumWritten() { return _nWritten; }
+    long getNumDropped() { return _nDropped; }
+    Snapshot &getNextFrame() { return _nextFrame; } // filled by the caller before queueNextFrame, e.g. from a replay
+
+    // typical behaviour methods
+    void addFrame(World &world, double simulationTime); // called by the simulation for every frame
+    void queueNextFrame();                              // hands the filled next frame to the encoder
+    void finish();                                      // writes all queued frames and closes the output
+
+private:
+    // typical behaviour methods
+    void encode();
+
+    Graphics _graphics;                     // compositor used for rendering, never opens a window
+    MpscRingQueue<Snapshot> _frames;        // snapshots waiting to be rendered and encoded
+    Snapshot _nextFrame;                    // snapshot being taken on the simulation thread
+    std::thread _encoder;                   // renders and encodes queued snapshots
+    cv::VideoWriter _writer;                // output for video files
+    std::string _outFilename;               // video file, or printf-style pattern such as frame_%05d.png
+    bool _isImageSequence;                  // writes numbered images instead of a video file
+    ExportPolicy _policy;
+    long _nAdded;                           // number of frames taken so far (simulation thread only)
+    std::atomic<long> _nWritten;            // number of frames encoded so far
+    std::atomic<long> _nDropped;            // number of frames discarded because the queue was full
+};
+
+#endif
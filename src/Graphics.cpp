@@ -1,75 +1,158 @@
 #include <iostream>
+#include <stdexcept>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 #include "Graphics.h"
-#include "Intersection.h"
 
 void Graphics::simulate()
 {
+    // create window
+    _windowName = "Concurrency Traffic Simulation";
+    cv::namedWindow(_windowName, cv::WINDOW_NORMAL);
+
     this->loadBackgroundImg();
     while (true)
     {
         // sleep at every iteration to reduce CPU usage
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
-        // update graphics
-        this->drawTrafficObjects();
+        // update graphics with the latest state published by the simulation
+        cv::imshow(_windowName, this->renderFrame(_snapshots->acquire()));
+        cv::waitKey(33);
     }
 }
 
 void Graphics::loadBackgroundImg()
 {
-    // create window
-    _windowName = "Concurrency Traffic Simulation";
-    cv::namedWindow(_windowName, cv::WINDOW_NORMAL);
-
-    // load image and create copy to be used for semi-transparent overlay
+    // load image and downscale it to the display size once, so frames never touch the full-resolution map
     cv::Mat background = cv::imread(_bgFilename);
-    _images.push_back(background);         // first element is the original background
-    _images.push_back(background.clone()); // second element will be the transparent overlay
-    _images.push_back(background.clone()); // third element will be the result image for display
+    if (background.empty())
+    {
+        throw std::runtime_error("Cannot load background image " + _bgFilename);
+    }
+    cv::Size displaySize(1040, 720);
+    _scaleX = (double)displaySize.width / background.cols;
+    _scaleY = (double)displaySize.height / background.rows;
+    cv::resize(background, _background, displaySize, 0, 0, cv::INTER_AREA);
+
+    // allocate the buffers for compositing, all frames are drawn into them in place
+    _overlay = _background.clone();
+    _frame = _background.clone();
+    _nTilesX = (displaySize.width + _tileSize - 1) / _tileSize;
+    _nTilesY = (displaySize.height + _tileSize - 1) / _tileSize;
+    _isTileDirty.assign(_nTilesX * _nTilesY, 0);
+    _tileSprites.assign(_nTilesX * _nTilesY, std::vector<int>());
+}
+
+// sets up the appearance of all traffic objects, which is constant except for colors
+void Graphics::createSprites(const Snapshot &snapshot)
+{
+    _sprites.clear();
+    for (const SnapshotObject &object : snapshot.objects)
+    {
+        Sprite sprite;
+        int radius = object.type == ObjectType::objectIntersection ? 25 : 50;
+        sprite.axes = cv::Size(cvRound(radius * _scaleX * (1 << _shift)), cvRound(radius * _scaleY * (1 << _shift)));
+        _sprites.push_back(sprite);
+    }
 }
 
-void Graphics::drawTrafficObjects()
+const cv::Mat &Graphics::renderFrame(const Snapshot &snapshot)
 {
-    // reset images
-    _images.at(1) = _images.at(0).clone();
-    _images.at(2) = _images.at(0).clone();
+    cv::Rect frameRect(0, 0, _frame.cols, _frame.rows);
+    for (auto &tile : _tileSprites)
+    {
+        tile.clear();
+    }
 
-    // create overlay from all traffic objects
-    for (auto it : _trafficObjects)
+    // find the sprites which moved or changed color and mark the tiles they left and entered as dirty
+    if (_sprites.size() != snapshot.objects.size())
     {
-        double posx, posy;
-        it->getPosition(posx, posy);
+        createSprites(snapshot);
+    }
+    for (size_t i = 0; i < snapshot.objects.size(); i++)
+    {
+        Sprite &sprite = _sprites[i];
+        const SnapshotObject &object = snapshot.objects[i];
+        double posx = object.x, posy = object.y;
+        cv::Scalar color(object.color[0], object.color[1], object.color[2]);
+        cv::Point center(cvRound(posx * _scaleX * (1 << _shift)), cvRound(posy * _scaleY * (1 << _shift)));
+
+        if (center != sprite.center || color != sprite.color || sprite.bounds.empty())
+        {
+            markDirty(sprite.bounds);
+            sprite.center = center;
+            sprite.color = color;
+
+            // bounding box of the ellipse in whole pixels, with a margin for anti-aliasing and rounding
+            int x0 = (center.x - sprite.axes.width) >> _shift, x1 = (center.x + sprite.axes.width) >> _shift;
+            int y0 = (center.y - sprite.axes.height) >> _shift, y1 = (center.y + sprite.axes.height) >> _shift;
+            sprite.bounds = cv::Rect(x0 - 1, y0 - 1, x1 - x0 + 3, y1 - y0 + 3) & frameRect;
+            markDirty(sprite.bounds);
+        }
+        addToTiles(sprite.bounds, i);
+    }
 
-        if (it->getType() == ObjectType::objectIntersection)
+    // compose the dirty tiles from the background and the sprites overlapping them
+    for (int t = 0; t < _nTilesX * _nTilesY; t++)
+    {
+        if (_isTileDirty[t])
         {
-            // cast object type from TrafficObject to Intersection
-            std::shared_ptr<Intersection> intersection = std::dynamic_pointer_cast<Intersection>(it);
+            composeTile(t);
+            _isTileDirty[t] = 0;
+        }
+    }
+
+    return _frame;
+}
 
-            // set color according to traffic light and draw the intersection as a circle
-            cv::Scalar trafficLightColor = intersection->trafficLightIsGreen() == true ? cv::Scalar(0, 255, 0) : cv::Scalar(0, 0, 255);
-            cv::circle(_images.at(1), cv::Point2d(posx, posy), 25, trafficLightColor, -1);
+void Graphics::markDirty(const cv::Rect &bounds)
+{
+    if (bounds.empty())
+    {
+        return;
+    }
+    for (int ty = bounds.y / _tileSize; ty <= (bounds.y + bounds.height - 1) / _tileSize; ty++)
+    {
+        for (int tx = bounds.x / _tileSize; tx <= (bounds.x + bounds.width - 1) / _tileSize; tx++)
+        {
+            _isTileDirty[ty * _nTilesX + tx] = 1;
         }
-        else if (it->getType() == ObjectType::objectVehicle)
+    }
+}
+
+void Graphics::addToTiles(const cv::Rect &bounds, int spriteIdx)
+{
+    if (bounds.empty())
+    {
+        return;
+    }
+    for (int ty = bounds.y / _tileSize; ty <= (bounds.y + bounds.height - 1) / _tileSize; ty++)
+    {
+        for (int tx = bounds.x / _tileSize; tx <= (bounds.x + bounds.width - 1) / _tileSize; tx++)
         {
-            cv::RNG rng(it->getID());
-            int b = rng.uniform(0, 255);
-            int g = rng.uniform(0, 255);
-            int r = sqrt(255*255 - g*g - b*b); // ensure that length of color vector is always 255
-            cv::Scalar vehicleColor = cv::Scalar(b,g,r);
-            cv::circle(_images.at(1), cv::Point2d(posx, posy), 50, vehicleColor, -1);
+            _tileSprites[ty * _nTilesX + tx].push_back(spriteIdx);
         }
     }
+}
+
+// redraws a single tile exactly like a full frame : opaque sprites on top of the background, blended with it
+void Graphics::composeTile(int tileIdx)
+{
+    int tx = tileIdx % _nTilesX, ty = tileIdx / _nTilesX;
+    cv::Rect roi = cv::Rect(tx * _tileSize, ty * _tileSize, _tileSize, _tileSize) & cv::Rect(0, 0, _frame.cols, _frame.rows);
+
+    // the sub-matrices share the buffers, so nothing is allocated here
+    cv::Mat overlay = _overlay(roi), background = _background(roi), frame = _frame(roi);
+    background.copyTo(overlay);
+    cv::Point offset(roi.x << _shift, roi.y << _shift);
+    for (int spriteIdx : _tileSprites[tileIdx])
+    {
+        const Sprite &sprite = _sprites[spriteIdx];
+        cv::ellipse(overlay, sprite.center - offset, sprite.axes, 0, 0, 360, sprite.color, -1, cv::LINE_8, _shift);
+    }
 
     float opacity = 0.85;
-    cv::addWeighted(_images.at(1), opacity, _images.at(0), 1.0 - opacity, 0, _images.at(2));
-
-    // The following code allows for resizing in case of graphics window taking up a large space 
-    cv::Mat img;
-    cv::resize(_images.at(2), img, cv::Size(1040,720),0,0,1);
-    cv::imshow(_windowName, img);
-    
-    cv::waitKey(33);
+    cv::addWeighted(overlay, opacity, background, 1.0 - opacity, 0, frame);
 }
@@ -4,7 +4,16 @@
 #include <string>
 #include <vector>
 #include <opencv2/core.hpp>
-#include "TrafficObject.h"
+#include "Snapshot.h"
+
+// auxiliary struct caching how a traffic object was drawn into the displayed frame
+struct Sprite
+{
+    cv::Scalar color;           // fill color
+    cv::Point center;           // center in display pixels, fixed-point with Graphics::_shift fractional bits
+    cv::Size axes;              // radii in display pixels, fixed-point with Graphics::_shift fractional bits
+    cv::Rect bounds;            // display pixels covered by the sprite, empty if not drawn yet
+};
 
 class Graphics
 {
@@ -13,21 +22,36 @@ public:
 
     // getters / setters
     void setBgFilename(std::string filename) { _bgFilename = filename; }
-    void setTrafficObjects(std::vector<std::shared_ptr<TrafficObject>> &trafficObjects) { _trafficObjects = trafficObjects; };
+    void setSnapshotBuffer(SnapshotBuffer &snapshots) { _snapshots = &snapshots; } // published by the simulation
+    cv::Size getFrameSize() { return _frame.size(); }
 
     // typical behaviour methods
-    void simulate();
+    void simulate();                                  // shows the published snapshots in a window
+    void loadBackgroundImg();                         // must be called before rendering frames
+    const cv::Mat &renderFrame(const Snapshot &snapshot); // composes a frame without a window, valid until the next call
 
 private:
     // typical behaviour methods
-    void loadBackgroundImg();
-    void drawTrafficObjects();
+    void createSprites(const Snapshot &snapshot);
+    void markDirty(const cv::Rect &bounds);
+    void addToTiles(const cv::Rect &bounds, int spriteIdx);
+    void composeTile(int tileIdx);
+
+    static const int _shift = 4;        // fractional bits of sprite coordinates, for sub-pixel placement
+    static const int _tileSize = 32;    // edge length of the square regions which are redrawn as a whole
 
     // member variables
-    std::vector<std::shared_ptr<TrafficObject>> _trafficObjects;
+    SnapshotBuffer *_snapshots;                 // source of consistent object states, read without blocking the simulation
     std::string _bgFilename;
     std::string _windowName;
-    std::vector<cv::Mat> _images;
+    cv::Mat _background;                        // background downscaled to the display size once at load time
+    cv::Mat _overlay;                           // scratch buffer with the opaque objects of the tile being composed
+    cv::Mat _frame;                             // displayed image, only dirty tiles are composed again
+    double _scaleX, _scaleY;                    // map pixels to display pixels
+    std::vector<Sprite> _sprites;               // drawing state of all traffic objects, same order as in the snapshots
+    int _nTilesX, _nTilesY;                     // number of tile columns and rows covering the frame
+    std::vector<char> _isTileDirty;             // tiles to be composed again in the current frame
+    std::vector<std::vector<int>> _tileSprites; // sprites overlapping each tile, in drawing order
 };
 
-#endif
\ No newline at end of file
+#endif
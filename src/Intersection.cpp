@@ -1,44 +1,176 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
-#include <future>
 #include <random>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 #include "Street.h"
 #include "Intersection.h"
 #include "Vehicle.h"
+#include "World.h"
+#include "Scheduler.h"
+#include "RoadGraph.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "AtomicWait.h"
+#include "TrajectoryFormat.h"
+
+/* Implementation of class "EntryWaiter" */
+
+void EntryWaiter::grant()
+{
+    _isGranted.store(1, std::memory_order_release);
+    atomicNotifyOne(_isGranted);
+}
+
+void EntryWaiter::wait()
+{
+    while (_isGranted.load(std::memory_order_acquire) == 0)
+    {
+        atomicWait(_isGranted, 0);
+    }
+}
 
 /* Implementation of class "WaitingVehicles" */
 
+WaitingVehicles::WaitingVehicles()
+{
+    _head = 0;
+    _size = 0;
+    _nOrdered = 0;
+    _maxSize = 0;
+}
+
 int WaitingVehicles::getSize()
 {
     std::lock_guard<std::mutex> lock(_mutex);
 
-    return _vehicles.size();
+    return _size;
 }
 
-void WaitingVehicles::pushBack(std::shared_ptr<Vehicle> vehicle, std::promise<void> &&promise)
+void WaitingVehicles::pushBack(int vehicleID, int movement, EntryWaiter &waiter, int64_t arrivalTime)
 {
     std::lock_guard<std::mutex> lock(_mutex);
 
-    _vehicles.push_back(vehicle);
-    _promises.push_back(std::move(promise));
+    if (_size == _entries.size())
+    {
+        grow();
+    }
+    _entries[(_head + _size) & (_entries.size() - 1)] = WaitingEntry{vehicleID, movement, arrivalTime, &waiter};
+    _size++;
+    if ((int)_size > _maxSize.load(std::memory_order_relaxed))
+    {
+        _maxSize.store(_size, std::memory_order_relaxed);
+    }
 }
 
-void WaitingVehicles::permitEntryToFirstInQueue()
+bool WaitingVehicles::getFront(WaitingEntry &front)
 {
     std::lock_guard<std::mutex> lock(_mutex);
 
-    // get entries from the front of both queues
-    auto firstPromise = _promises.begin();
-    auto firstVehicle = _vehicles.begin();
+    if (_size == 0)
+    {
+        return false;
+    }
+    front = _entries[_head];
+    return true;
+}
 
-    // fulfill promise and send signal back that permission to enter has been granted
-    firstPromise->set_value();
+// the waiter is granted by the caller after all locks have been released, so that the woken vehicle does not block on them
+void WaitingVehicles::popFront()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
 
-    // remove front elements from both queues
-    _vehicles.erase(firstVehicle);
-    _promises.erase(firstPromise);
+    _head = (_head + 1) & (_entries.size() - 1);
+    _size--;
+    if (_nOrdered > 0)
+    {
+        _nOrdered--;
+    }
+}
+
+// sorts the vehicles which arrived since the last call by id, so that vehicles arriving
+// concurrently within the same tick are queued independently of thread scheduling
+void WaitingVehicles::orderArrivals()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_size - _nOrdered > 1)
+    {
+        // the arrivals may wrap around the end of the ring, so they are sorted in scratch space
+        size_t mask = _entries.size() - 1;
+        _arrivals.clear();
+        for (size_t i = _nOrdered; i < _size; i++)
+        {
+            _arrivals.push_back(_entries[(_head + i) & mask]);
+        }
+        std::sort(_arrivals.begin(), _arrivals.end(), [](const WaitingEntry &a, const WaitingEntry &b) { return a.vehicleID < b.vehicleID; });
+        for (size_t i = 0; i < _arrivals.size(); i++)
+        {
+            _entries[(_head + _nOrdered + i) & mask] = _arrivals[i];
+        }
+    }
+    _nOrdered = _size;
+}
+
+void WaitingVehicles::saveState(ByteWriter &writer)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    writer.putVarint(_maxSize.load(std::memory_order_relaxed));
+    writer.putVarint(_nOrdered);
+    writer.putVarint(_size);
+    for (size_t i = 0; i < _size; i++)
+    {
+        const WaitingEntry &entry = _entries[(_head + i) & (_entries.size() - 1)];
+        writer.putVarint(entry.vehicleID);
+        writer.putVarint(entry.movement);
+        writer.putZigzag(entry.arrivalTime);
+    }
+}
+
+// every entry takes at least 3 bytes, so that a corrupt count cannot make the queue grow beyond the data
+void WaitingVehicles::restoreState(ByteReader &reader, World &world, int nMovements)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    int maxSize = reader.getVarint();
+    size_t nOrdered = reader.getVarint();
+    size_t n = reader.getCount(3);
+    if (nOrdered > n)
+    {
+        throw std::runtime_error("more ordered than waiting vehicles");
+    }
+    _nOrdered = nOrdered;
+    _head = 0;
+    _size = 0;
+    while (_size < n)
+    {
+        if (_size == _entries.size())
+        {
+            grow();
+        }
+        WaitingEntry &entry = _entries[_size++];
+        entry.vehicleID = ByteReader::checkID(reader.getVarint(), world.getVehicles().size());
+        entry.movement = ByteReader::checkID(reader.getVarint(), nMovements);
+        entry.arrivalTime = reader.getZigzag();
+        entry.waiter = &world.getVehicle(entry.vehicleID).getEntryWaiter();
+    }
+    _maxSize.store(maxSize, std::memory_order_relaxed);
+}
+
+// doubles the capacity of the full ring and unwraps the queue to its start, must be called with _mutex held
+void WaitingVehicles::grow()
+{
+    std::vector<WaitingEntry> entries(std::max<size_t>(4, _entries.size() * 2));
+    for (size_t i = 0; i < _size; i++)
+    {
+        entries[i] = _entries[(_head + i) & (_entries.size() - 1)];
+    }
+    _entries.swap(entries);
+    _head = 0;
 }
 
 /* Implementation of class "Intersection" */
@@ -46,106 +178,344 @@ void WaitingVehicles::permitEntryToFirstInQueue()
 Intersection::Intersection()
 {
     _type = ObjectType::objectIntersection;
-    _isBlocked = false;
+    _nApproaches = 0;
+    _approachStages = nullptr;
+    _conflicts = nullptr;
+    _nConflictWords = 0;
+    _firstApproach = 0;
+    _scheduler = nullptr;
+    _isSignalled = false;
+    _wakeUpTime = -1.0;
+    _nAdmissions = 0;
+    _totalEntryWait = 0;
+}
+
+int Intersection::getQueueLength()
+{
+    int length = 0;
+    for (auto &queue : _waitingVehicles)
+    {
+        length += queue->getSize();
+    }
+    return length;
+}
+
+int Intersection::getMaxQueueLength()
+{
+    int maxLength = 0;
+    for (auto &queue : _waitingVehicles)
+    {
+        maxLength = std::max(maxLength, queue->getMaxSize());
+    }
+    return maxLength;
 }
 
-void Intersection::addStreet(std::shared_ptr<Street> street)
+void Intersection::addStreet(Street &street)
 {
-    _streets.push_back(street);
+    _streets.push_back(street.getID());
 }
 
-std::vector<std::shared_ptr<Street>> Intersection::queryStreets(std::shared_ptr<Street> incoming)
+void Intersection::setRoadGraph(const RoadGraph &roadGraph)
 {
-    // store all outgoing streets in a vector ...
-    std::vector<std::shared_ptr<Street>> outgoings;
-    for (auto it : _streets)
+    _nApproaches = roadGraph.getDegree(_id);
+    _approachStages = roadGraph.getApproachStages(_id);
+    _conflicts = roadGraph.getConflicts(_id);
+    _nConflictWords = RoadGraph::getNumConflictWords(_nApproaches);
+
+    // the queues are the only part which belongs to this intersection, they allocate on their first vehicle
+    _waitingVehicles.resize(_nApproaches);
+    for (auto &queue : _waitingVehicles)
     {
-        if (incoming->getID() != it->getID()) // ... except the street making the inquiry
+        if (!queue)
         {
-            outgoings.push_back(it);
+            queue.reset(new WaitingVehicles());
         }
     }
+    _firstApproach = 0;
+}
 
-    return outgoings;
+void Intersection::queryStreets(int incomingID, std::vector<int> &outgoingIDs)
+{
+    // store all outgoing streets in the given vector ...
+    outgoingIDs.clear();
+    for (int streetID : _streets)
+    {
+        if (incomingID != streetID) // ... except the street making the inquiry
+        {
+            outgoingIDs.push_back(streetID);
+        }
+    }
 }
 
-// adds a new vehicle to the queue and returns once the vehicle is allowed to enter
-void Intersection::addVehicleToQueue(std::shared_ptr<Vehicle> vehicle)
+// adds a new vehicle to the queue of its approach and returns once the vehicle is allowed to enter
+void Intersection::addVehicleToQueue(int vehicleID, int approach, int exit, EntryWaiter &waiter)
 {
-    std::unique_lock<std::mutex> lck(_mtx);
-    std::cout << "Intersection #" << _id << "::addVehicleToQueue: thread id = " << std::this_thread::get_id() << std::endl;
-    lck.unlock();
+    LOG_DEBUG("Intersection #{}::addVehicleToQueue: Vehicle #{} approaches", _id, vehicleID);
 
     // add new vehicle to the end of the waiting line
-    std::promise<void> prmsVehicleAllowedToEnter;
-    std::future<void> ftrVehicleAllowedToEnter = prmsVehicleAllowedToEnter.get_future();
-    _waitingVehicles.pushBack(vehicle, std::move(prmsVehicleAllowedToEnter));
+    requestEntry(vehicleID, approach, exit, waiter);
 
-    // wait until the vehicle is allowed to enter
-    ftrVehicleAllowedToEnter.wait();
-    lck.lock();
-    std::cout << "Intersection #" << _id << ": Vehicle #" << vehicle->getID() << " is granted entry." << std::endl;
-    
-    // FP.6b : use the methods TrafficLight::getCurrentPhase and TrafficLight::waitForGreen to block the execution until the traffic light turns green.
-
-    lck.unlock();
+    // wait until the vehicle is allowed to enter, which is only granted while its approach has green
+    waiter.wait();
+    LOG_INFO_SAMPLED("Intersection #{}: Vehicle #{} is granted entry.", _id, vehicleID);
 }
 
-void Intersection::vehicleHasLeft(std::shared_ptr<Vehicle> vehicle)
+// adds a new vehicle to the end of the waiting line of its approach and returns immediately
+void Intersection::requestEntry(int vehicleID, int approach, int exit, EntryWaiter &waiter)
 {
-    //std::cout << "Intersection #" << _id << ": Vehicle #" << vehicle->getID() << " has left." << std::endl;
-
-    // unblock queue processing
-    this->setIsBlocked(false);
+    waiter.reset();
+    _waitingVehicles[approach]->pushBack(vehicleID, getMovement(approach, exit), waiter, getClock());
+    Metrics::getInstance().increment(counterEntryRequests);
+    signalAdmission();
 }
 
-void Intersection::setIsBlocked(bool isBlocked)
+void Intersection::vehicleHasLeft(int vehicleID)
 {
-    _isBlocked = isBlocked;
-    //std::cout << "Intersection #" << _id << " isBlocked=" << isBlocked << std::endl;
+    LOG_DEBUG_SAMPLED("Intersection #{}: Vehicle #{} has left.", _id, vehicleID);
+
+    // free the movement of the vehicle, the order of the crossing vehicles does not matter
+    std::unique_lock<std::mutex> lck(_admissionMutex);
+    for (size_t i = 0; i < _crossingVehicles.size(); i++)
+    {
+        if (_crossingVehicles[i].vehicleID == vehicleID)
+        {
+            Metrics::getInstance().record(histogramCrossing, getClock() - _crossingVehicles[i].admissionTime);
+            _crossingVehicles[i] = _crossingVehicles.back();
+            _crossingVehicles.pop_back();
+            break;
+        }
+    }
+    lck.unlock();
+
+    // vehicles blocked by the movement may enter now
+    signalAdmission();
 }
 
 // virtual function which is executed in a thread
 void Intersection::simulate() // using threads + promises/futures + exceptions
 {
-    // FP.6a : In Intersection.h, add a private member _trafficLight of type TrafficLight. At this position, start the simulation of _trafficLight.
-
     // launch vehicle queue processing in a thread
     threads.emplace_back(std::thread(&Intersection::processVehicleQueue, this));
 }
 
 void Intersection::processVehicleQueue()
 {
-    // print id of the current thread
-    //std::cout << "Intersection #" << _id << "::processVehicleQueue: thread id = " << std::this_thread::get_id() << std::endl;
+    LOG_DEBUG("Intersection #{}::processVehicleQueue: started", _id);
 
-    // continuously process the vehicle queue
+    // continuously process the vehicle queues
+    std::unique_lock<std::mutex> lck(_admissionMutex);
     while (true)
     {
-        // sleep at every iteration to reduce CPU usage
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        int64_t clock = getClock();
+        double timeToGreen = selectAdmissions(clock);
+        if (!_admissions.empty())
+        {
+            lck.unlock();
+            grantAdmissions(clock);
+            lck.lock();
+        }
+        else if (timeToGreen > 0.0)
+        {
+            // sleep until the light turns green for a waiting vehicle, unless an arrival or departure comes first
+            _admissionCondition.wait_for(lck, std::chrono::duration<double>(timeToGreen));
+        }
+        else
+        {
+            // sleep until an arrival or departure makes an admission possible
+            _admissionCondition.wait(lck);
+        }
+    }
+}
+
+void Intersection::step()
+{
+    // accept new signals from now on and queue this tick's arrivals in a reproducible order
+    _isSignalled = false;
+    for (auto &queue : _waitingVehicles)
+    {
+        queue->orderArrivals();
+    }
+
+    int64_t clock = getClock();
+    double time = clock * 1e-9;
+    std::unique_lock<std::mutex> lck(_admissionMutex);
+    double timeToGreen = selectAdmissions(clock);
+    if (timeToGreen > 0.0 && _scheduler && _wakeUpTime <= time)
+    {
+        // vehicles wait at a red light, let the scheduler signal this intersection again once it turns green
+        _wakeUpTime = time + timeToGreen;
+        _scheduler->signalIntersectionAt(this, _wakeUpTime);
+    }
+    lck.unlock();
+
+    grantAdmissions(clock);
+}
 
-        // only proceed when at least one vehicle is waiting in the queue
-        if (_waitingVehicles.getSize() > 0 && !_isBlocked)
+// wakes the admission controller after an arrival, a departure or when the light turns green
+void Intersection::signalAdmission()
+{
+    if (_scheduler)
+    {
+        // let the scheduler step this intersection in the current tick
+        if (!_isSignalled.exchange(true))
+        {
+            _scheduler->signalIntersection(this);
+        }
+    }
+    else
+    {
+        // acquiring the mutex orders this signal after a concurrent predicate check, so no wake-up is lost
+        std::lock_guard<std::mutex> lock(_admissionMutex);
+        _admissionCondition.notify_one();
+    }
+}
+
+// moves every waiting vehicle which has green and does not conflict with a crossing vehicle from its queue to
+// _admissions, must be called with _admissionMutex held. Each approach is served in the order of its queue.
+double Intersection::selectAdmissions(int64_t clock)
+{
+    double time = clock * 1e-9;
+    double minTimeToGreen = 0.0;
+    WaitingEntry front;
+    for (int i = 0; i < _nApproaches; i++)
+    {
+        int approach = (_firstApproach + i) % _nApproaches;
+        WaitingVehicles &queue = *_waitingVehicles[approach];
+        if (!queue.getFront(front))
         {
-            // set intersection to "blocked" to prevent other vehicles from entering
-            this->setIsBlocked(true);
+            continue;
+        }
+        double timeToGreen = _trafficLight.getTimeToGreen(time, _approachStages[approach]);
+        if (timeToGreen > 0.0)
+        {
+            minTimeToGreen = minTimeToGreen == 0.0 ? timeToGreen : std::min(minTimeToGreen, timeToGreen);
+            continue;
+        }
+        do
+        {
+            bool isBlocked = false;
+            for (const CrossingVehicle &crossing : _crossingVehicles)
+            {
+                if (isConflicting(front.movement, crossing.movement))
+                {
+                    isBlocked = true;
+                    break;
+                }
+            }
+            if (isBlocked)
+            {
+                break;
+            }
+            queue.popFront();
+            _crossingVehicles.push_back(CrossingVehicle{front.vehicleID, front.movement, clock});
+            _admissions.push_back(front);
+        } while (queue.getFront(front));
+    }
+    if (_nApproaches > 0)
+    {
+        _firstApproach = (_firstApproach + 1) % _nApproaches;
+    }
+    return minTimeToGreen;
+}
 
-            // permit entry to first vehicle in the queue (FIFO)
-            _waitingVehicles.permitEntryToFirstInQueue();
+// permits entry to the selected vehicles and accounts for their waits, the part spent at a red light on the same clock
+void Intersection::grantAdmissions(int64_t clock)
+{
+    for (const WaitingEntry &entry : _admissions)
+    {
+        int64_t wait = clock - entry.arrivalTime;
+        Metrics::getInstance().record(histogramEntryWait, wait);
+        int stage = _approachStages[entry.movement / _nApproaches];
+        double redWait = _trafficLight.getRedWait(entry.arrivalTime * 1e-9, clock * 1e-9, stage);
+        if (redWait > 0.0)
+        {
+            Metrics::getInstance().record(histogramRedLightWait, std::llround(redWait * 1e9));
         }
+        Metrics::getInstance().increment(counterAdmissions);
+        _nAdmissions.store(_nAdmissions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        _totalEntryWait.store(_totalEntryWait.load(std::memory_order_relaxed) + wait, std::memory_order_relaxed);
+        entry.waiter->grant();
     }
+    _admissions.clear();
+}
+
+// in step mode waits are measured on the virtual clock, so that they do not depend on the speed of the machine
+int64_t Intersection::getClock()
+{
+    if (_scheduler)
+    {
+        return std::llround(_scheduler->getSimulationTime() * 1e9);
+    }
+    return Metrics::getWallClock();
 }
 
 bool Intersection::trafficLightIsGreen()
 {
-   // please include this part once you have solved the final project tasks
-   /*
-   if (_trafficLight.getCurrentPhase() == TrafficLightPhase::green)
-       return true;
-   else
-       return false;
-   */
+    return _trafficLight.getPhase(getClock() * 1e-9) == TrafficLightPhase::green;
+}
+
+// the light needs no state of its own besides its plan, its phase and timer follow from the simulated time
+void Intersection::saveState(ByteWriter &writer)
+{
+    const SignalPlan &plan = _trafficLight.getPlan();
+    writer.put<double>(plan.cycleLength);
+    writer.put<double>(plan.greenDuration);
+    writer.put<double>(plan.offset);
+    writer.put<double>(_wakeUpTime);
+    writer.putVarint(_firstApproach);
+    writer.putVarint(getNumAdmissions());
+    writer.putZigzag(getTotalEntryWait());
 
-  return true; // makes traffic light permanently green
-} 
\ No newline at end of file
+    writer.putVarint(_nApproaches);
+    for (auto &queue : _waitingVehicles)
+    {
+        queue->saveState(writer);
+    }
+    std::lock_guard<std::mutex> lock(_admissionMutex);
+    writer.putVarint(_crossingVehicles.size());
+    for (const CrossingVehicle &crossing : _crossingVehicles)
+    {
+        writer.putVarint(crossing.vehicleID);
+        writer.putVarint(crossing.movement);
+        writer.putZigzag(crossing.admissionTime);
+    }
+}
+
+void Intersection::restoreState(ByteReader &reader, World &world)
+{
+    SignalPlan plan;
+    plan.cycleLength = reader.get<double>();
+    plan.greenDuration = reader.get<double>();
+    plan.offset = reader.get<double>();
+    if (!(plan.cycleLength > 0.0))
+    {
+        throw std::runtime_error("Intersection #" + std::to_string(_id) + " has an invalid signal plan");
+    }
+    _trafficLight.setPlan(plan);
+    _wakeUpTime = reader.get<double>();
+    _firstApproach = reader.getVarint();
+    _nAdmissions = reader.getVarint();
+    _totalEntryWait = reader.getZigzag();
+
+    if ((int)reader.getVarint() != _nApproaches)
+    {
+        throw std::runtime_error("Intersection #" + std::to_string(_id) + " has a different number of approaches");
+    }
+    if (_nApproaches > 0)
+    {
+        ByteReader::checkID(_firstApproach, _nApproaches);
+    }
+    int nMovements = _nApproaches * _nApproaches;
+    for (auto &queue : _waitingVehicles)
+    {
+        queue->restoreState(reader, world, nMovements);
+    }
+    std::lock_guard<std::mutex> lock(_admissionMutex);
+    _crossingVehicles.resize(reader.getCount(3));
+    for (CrossingVehicle &crossing : _crossingVehicles)
+    {
+        crossing.vehicleID = ByteReader::checkID(reader.getVarint(), world.getVehicles().size());
+        crossing.movement = ByteReader::checkID(reader.getVarint(), nMovements);
+        crossing.admissionTime = reader.getZigzag();
+    }
+}
@@ -2,32 +2,96 @@
 #define INTERSECTION_H
 
 #include <vector>
-#include <future>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <memory>
 #include "TrafficObject.h"
+#include "TrafficLight.h"
 
 // forward declarations to avoid include cycle
 class Street;
 class Vehicle;
+class Scheduler;
+class RoadGraph;
+class World;
+class ByteWriter;
+class ByteReader;
 
-// auxiliary class to queue and dequeue waiting vehicles in a thread-safe manner
+// auxiliary class signalling the grant of an entry request to the requesting vehicle. It is owned by the vehicle
+// and reused for all of its requests, so that requesting entry allocates nothing.
+class EntryWaiter
+{
+public:
+    // constructor / desctructor
+    EntryWaiter() { _isGranted = 0; }
+
+    // getters / setters
+    bool isGranted() { return _isGranted.load(std::memory_order_acquire) != 0; }
+
+    // typical behaviour methods
+    void reset() { _isGranted.store(0, std::memory_order_relaxed); } // prepares the next request
+    void grant();                                                    // called by the intersection, wakes a blocked owner
+    void wait();                                                     // blocks the owner until entry has been granted
+
+private:
+    std::atomic<uint32_t> _isGranted; // futex word, 1 once entry has been granted
+};
+
+// auxiliary struct holding a single vehicle in the queue of an intersection
+struct WaitingEntry
+{
+    int vehicleID;
+    int movement;         // movement the vehicle is going to make, see Intersection::getMovement
+    int64_t arrivalTime;  // time of the entry request in ns, see Intersection::getClock
+    EntryWaiter *waiter;  // signalled on admission, owned by the vehicle
+};
+
+// auxiliary struct holding a single vehicle which has been admitted and not yet left the intersection
+struct CrossingVehicle
+{
+    int vehicleID;
+    int movement;
+    int64_t admissionTime; // in ns, see Intersection::getClock
+};
+
+// auxiliary class to queue and dequeue waiting vehicles in a thread-safe manner : a growable ring
+// buffer, so that pushing and admitting are O(1) and only allocate when a queue grows longer than ever before
 class WaitingVehicles
 {
 public:
+    // constructor / desctructor
+    WaitingVehicles();
+
     // getters / setters
     int getSize();
+    int getMaxSize() { return _maxSize.load(std::memory_order_relaxed); } // longest queue so far
 
     // typical behaviour methods
-    void pushBack(std::shared_ptr<Vehicle> vehicle, std::promise<void> &&promise);
-    void permitEntryToFirstInQueue();
+    void pushBack(int vehicleID, int movement, EntryWaiter &waiter, int64_t arrivalTime);
+    bool getFront(WaitingEntry &front); // returns false if the queue is empty
+    void popFront();                    // removes the front entry, which the caller grants afterwards
+    void orderArrivals();
+    void saveState(ByteWriter &writer);
+    void restoreState(ByteReader &reader, World &world, int nMovements); // replaces all entries, the waiters are those of the saved vehicles
 
 private:
-    std::vector<std::shared_ptr<Vehicle>> _vehicles;          // list of all vehicles waiting to enter this intersection
-    std::vector<std::promise<void>> _promises; // list of associated promises
+    // typical behaviour methods
+    void grow();
+
+    std::vector<WaitingEntry> _entries;        // ring buffer, its capacity is a power of two once the first vehicle arrived
+    size_t _head;                              // position of the first vehicle in the queue
+    size_t _size;                              // number of vehicles waiting to enter this intersection
+    std::vector<WaitingEntry> _arrivals;       // scratch space of orderArrivals, kept to avoid reallocation
+    std::atomic<int> _maxSize;                 // written under _mutex, read by the metrics exporter
+    size_t _nOrdered;                          // number of vehicles at the front of the queue already put in order
     std::mutex _mutex;
 };
 
+// intersection admitting vehicles per approach : every incoming street has a queue of its own, the traffic light
+// gives green to the approaches of one stage at a time, and any number of vehicles cross concurrently as long as
+// their movements do not conflict. Approaches and exits are numbered like the edges of the intersection in the
+// RoadGraph, which also holds their stages and conflicts, a movement is the pair of both.
 class Intersection : public TrafficObject
 {
 public:
@@ -35,25 +99,64 @@ public:
     Intersection();
 
     // getters / setters
-    void setIsBlocked(bool isBlocked);
+    void setScheduler(Scheduler *scheduler) { _scheduler = scheduler; }
+    void setTrafficLightRandomStream(RandomStream random) { _trafficLight.setRandomStream(random); }
+    void setSignalPlan(const SignalPlan &plan) { _trafficLight.setPlan(plan); }
+    const SignalPlan &getSignalPlan() { return _trafficLight.getPlan(); }
+    void reserveStreets(int nStreets) { _streets.reserve(nStreets); }
+    void setRoadGraph(const RoadGraph &roadGraph); // sets up a queue per approach (called by World::buildRoadGraph)
+    int getNumApproaches() { return _nApproaches; }
+    int getApproachStage(int approach) { return _approachStages[approach]; } // stage of the light which gives green to an approach
+    int getMovement(int approach, int exit) { return approach * _nApproaches + exit; }
+    bool isConflicting(int movement, int otherMovement) // looked up in the precomputed conflict matrix
+    {
+        return (_conflicts[movement * _nConflictWords + otherMovement / 64] >> (otherMovement % 64)) & 1;
+    }
+    int getQueueLength();
+    int getMaxQueueLength(); // longest queue of a single approach so far
+    uint64_t getNumAdmissions() { return _nAdmissions.load(std::memory_order_relaxed); }
+    int64_t getTotalEntryWait() { return _totalEntryWait.load(std::memory_order_relaxed); } // in ns
+    double getWakeUpTime() { return _wakeUpTime; } // in s, see Scheduler::restore
 
     // typical behaviour methods
-    void addVehicleToQueue(std::shared_ptr<Vehicle> vehicle);
-    void addStreet(std::shared_ptr<Street> street);
-    std::vector<std::shared_ptr<Street>> queryStreets(std::shared_ptr<Street> incoming); // return pointer to current list of all outgoing streets
+    void addVehicleToQueue(int vehicleID, int approach, int exit, EntryWaiter &waiter); // blocks until entry has been granted
+    void requestEntry(int vehicleID, int approach, int exit, EntryWaiter &waiter); // non-blocking variant of addVehicleToQueue, the waiter is granted later
+    void addStreet(Street &street);
+    void queryStreets(int incomingID, std::vector<int> &outgoingIDs); // fills in the ids of all outgoing streets
     void simulate();
-    void vehicleHasLeft(std::shared_ptr<Vehicle> vehicle);
-    bool trafficLightIsGreen();
+    void step(); // admits all waiting vehicles which may enter (called by the Scheduler once signalled)
+    void signalAdmission(); // wakes the admission controller, e.g. when the light turns green
+    void vehicleHasLeft(int vehicleID);
+    bool trafficLightIsGreen(); // phase of the approaches of stage 0, as shown by the renderer
+    void saveState(ByteWriter &writer);                  // appends plan, queues and crossing vehicles, between two ticks only (see Checkpoint)
+    void restoreState(ByteReader &reader, World &world); // throws if the saved intersection has another number of approaches or is corrupt
 
 private:
 
     // typical behaviour methods
     void processVehicleQueue();
+    double selectAdmissions(int64_t clock); // returns the time in s until a waiting vehicle gets green, 0 if there is none
+    void grantAdmissions(int64_t clock);
+    int64_t getClock(); // simulated time in ns in step mode, wall-clock time otherwise
 
     // private members
-    std::vector<std::shared_ptr<Street>> _streets;   // list of all streets connected to this intersection
-    WaitingVehicles _waitingVehicles; // list of all vehicles and their associated promises waiting to enter the intersection
-    bool _isBlocked;                  // flag indicating wether the intersection is blocked by a vehicle
+    std::vector<int> _streets;        // ids of all streets connected to this intersection
+    int _nApproaches;                 // number of incoming streets, equal to the degree in the road graph
+    const int *_approachStages;       // stage of the light which gives green to every approach, held by the road graph
+    const uint64_t *_conflicts;       // bit matrix with a row of _nConflictWords words for every movement, held by the road graph
+    int _nConflictWords;
+    std::vector<std::unique_ptr<WaitingVehicles>> _waitingVehicles; // vehicles and their waiters waiting to enter, one queue per approach
+    std::vector<CrossingVehicle> _crossingVehicles; // admitted vehicles which have not left yet, protected by _admissionMutex
+    std::vector<WaitingEntry> _admissions;          // selected under _admissionMutex and granted after releasing it, kept to avoid reallocation
+    int _firstApproach;               // approach served first by the next selection, rotates so that no approach is starved
+    TrafficLight _trafficLight;       // traffic light controlling entry to this intersection
+    std::mutex _admissionMutex;       // protects _crossingVehicles and orders arrivals and departures with the admission controller
+    std::condition_variable _admissionCondition; // wakes the admission thread on arrivals and departures (thread-per-object mode)
+    Scheduler *_scheduler;            // scheduler to be signalled on arrivals and departures (step mode), nullptr otherwise
+    std::atomic<bool> _isSignalled;   // prevents an intersection from being queued at the scheduler more than once per tick
+    double _wakeUpTime;               // time in s at which the scheduler signals this intersection because its light turns green
+    std::atomic<uint64_t> _nAdmissions;   // vehicles admitted so far, written by the admission controller only
+    std::atomic<int64_t> _totalEntryWait; // sum of the waits of all admitted vehicles in ns, written by the admission controller only
 };
 
 #endif
@@ -0,0 +1,195 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include "Logger.h"
+
+/* Implementation of class "LogRing" */
+
+LogRing::LogRing(int threadIdx, size_t capacity)
+{
+    // round the capacity up to a power of two, so that positions map to records with a mask
+    size_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    _records.resize(size);
+    _mask = size - 1;
+    _threadIdx = threadIdx;
+    _head = 0;
+    _tail = 0;
+    _nDropped = 0;
+}
+
+void LogRing::push(const LogRecord &record)
+{
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) > _mask)
+    {
+        _nDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _records[tail & _mask] = record;
+    _records[tail & _mask].threadIdx = _threadIdx;
+    _tail.store(tail + 1, std::memory_order_release);
+}
+
+void LogRing::drain(std::vector<LogRecord> &batch)
+{
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    uint64_t tail = _tail.load(std::memory_order_acquire);
+    for (; head != tail; head++)
+    {
+        batch.push_back(_records[head & _mask]);
+    }
+    _head.store(head, std::memory_order_release);
+}
+
+/* Implementation of class "Logger" */
+
+Logger &Logger::getInstance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+{
+    _out = &std::cout;
+    _start = std::chrono::steady_clock::now();
+    _samplingPeriod = 1;
+    _isStopping = false;
+    _drainThread = std::thread(&Logger::drainLoop, this);
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(_drainMutex);
+        _isStopping = true;
+    }
+    _drainCondition.notify_one();
+    _drainThread.join();
+    flush();
+}
+
+void Logger::setOutput(std::ostream &out)
+{
+    std::lock_guard<std::mutex> lock(_outputMutex);
+    _out = &out;
+}
+
+void Logger::flush()
+{
+    drainOnce();
+}
+
+// returns the ring of the calling thread, taking one on its first message
+LogRing &Logger::getThreadRing()
+{
+    // hands the ring back when the thread ends, so that short-lived threads do not accumulate rings
+    struct ThreadRing
+    {
+        LogRing *ring = nullptr;
+        ~ThreadRing()
+        {
+            if (ring)
+            {
+                Logger::getInstance().releaseRing(ring);
+            }
+        }
+    };
+    static thread_local ThreadRing threadRing;
+
+    if (!threadRing.ring)
+    {
+        std::lock_guard<std::mutex> lock(_ringMutex);
+        if (_freeRings.empty())
+        {
+            _rings.emplace_back(new LogRing(_rings.size(), 1024));
+            threadRing.ring = _rings.back().get();
+        }
+        else
+        {
+            // the ring may still hold messages of its previous thread, they are drained in order
+            threadRing.ring = _freeRings.back();
+            _freeRings.pop_back();
+        }
+    }
+    return *threadRing.ring;
+}
+
+void Logger::releaseRing(LogRing *ring)
+{
+    std::lock_guard<std::mutex> lock(_ringMutex);
+    _freeRings.push_back(ring);
+}
+
+void Logger::drainLoop()
+{
+    // polling keeps the logging threads free of any notification
+    std::unique_lock<std::mutex> lck(_drainMutex);
+    while (!_isStopping)
+    {
+        _drainCondition.wait_for(lck, std::chrono::milliseconds(10));
+        lck.unlock();
+        drainOnce();
+        lck.lock();
+    }
+}
+
+// collects the messages of all rings, orders them by time and writes them with a single flush
+void Logger::drainOnce()
+{
+    std::lock_guard<std::mutex> outputLock(_outputMutex);
+    _batch.clear();
+    std::vector<std::pair<int, uint64_t>> drops;
+    {
+        std::lock_guard<std::mutex> lock(_ringMutex);
+        _nReportedDrops.resize(_rings.size(), 0);
+        for (size_t r = 0; r < _rings.size(); r++)
+        {
+            _rings[r]->drain(_batch);
+            uint64_t nDropped = _rings[r]->getNumDropped();
+            if (nDropped != _nReportedDrops[r])
+            {
+                drops.emplace_back(r, nDropped - _nReportedDrops[r]);
+                _nReportedDrops[r] = nDropped;
+            }
+        }
+    }
+    if (_batch.empty() && drops.empty())
+    {
+        return;
+    }
+
+    std::stable_sort(_batch.begin(), _batch.end(), [](const LogRecord &a, const LogRecord &b) { return a.time < b.time; });
+    static const char *levelNames[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+    std::ostream &out = *_out;
+    char prefix[64];
+    for (const LogRecord &record : _batch)
+    {
+        std::snprintf(prefix, sizeof(prefix), "[%12.6f] [t%d] %s ", record.time * 1e-9, record.threadIdx, levelNames[std::min<int>(record.level, 3)]);
+        out << prefix;
+
+        // replace every placeholder by the next argument
+        const char *format = record.format;
+        int arg = 0;
+        while (const char *placeholder = std::strstr(format, "{}"))
+        {
+            out.write(format, placeholder - format);
+            if (arg < record.nArgs)
+            {
+                out << record.args[arg++];
+            }
+            format = placeholder + 2;
+        }
+        out << format << '\n';
+    }
+    for (auto &drop : drops)
+    {
+        out << "[log] " << drop.second << " messages of thread t" << drop.first << " dropped" << '\n';
+    }
+    out.flush();
+}
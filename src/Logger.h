@@ -0,0 +1,159 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+// log levels. Messages below LOG_LEVEL are removed at compile time, arguments included,
+// e.g. build with -DLOG_LEVEL=LOG_LEVEL_WARNING to compile out all informational messages
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// auxiliary struct holding a single log message as taken on the logging thread : a format string
+// literal with "{}" placeholders and up to four integer arguments, formatted later by the drain thread
+struct LogRecord
+{
+    int64_t time;         // steady clock in ns
+    const char *format;   // must outlive the logger, i.e. a string literal
+    int64_t args[4];      // values of the placeholders
+    int32_t threadIdx;    // short number of the logging thread, filled in by its ring
+    uint8_t level;        // one of LOG_LEVEL_*
+    uint8_t nArgs;        // number of valid args
+};
+
+// auxiliary class buffering the messages of a single thread : a bounded single-producer single-consumer
+// ring, so logging is a few stores and never waits. Messages are dropped and counted when it is full.
+class LogRing
+{
+public:
+    // constructor / desctructor
+    LogRing(int threadIdx, size_t capacity);
+
+    // getters / setters
+    int getThreadIdx() { return _threadIdx; }
+    uint64_t getNumDropped() { return _nDropped.load(std::memory_order_relaxed); }
+
+    // typical behaviour methods
+    void push(const LogRecord &record);        // called by the owning thread only
+    void drain(std::vector<LogRecord> &batch); // called by the drain thread only
+
+private:
+    std::vector<LogRecord> _records;
+    size_t _mask;                                 // capacity - 1, the capacity is a power of two
+    int _threadIdx;                               // short thread number printed with every message
+    alignas(64) std::atomic<uint64_t> _head;      // next record to drain, written by the drain thread
+    alignas(64) std::atomic<uint64_t> _tail;      // next record to fill, written by the owning thread
+    std::atomic<uint64_t> _nDropped;              // messages lost because the ring was full
+};
+
+// process-wide logger : every thread writes into a ring of its own and a background thread merges all rings
+// in time order and writes them out in batches, so that hot paths neither lock nor wait for console I/O
+class Logger
+{
+public:
+    // constructor / desctructor
+    static Logger &getInstance();
+    ~Logger();
+
+    // getters / setters
+    void setOutput(std::ostream &out);                         // default: std::cout
+    void setSamplingPeriod(long period) { _samplingPeriod = period; } // sampled messages are logged once every period calls
+    long getSamplingPeriod() { return _samplingPeriod.load(std::memory_order_relaxed); }
+
+    // typical behaviour methods
+    template <class... Args>
+    void log(int level, const char *format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= 4, "at most four arguments per log message");
+        static_assert((std::is_integral<Args>::value && ... && true), "log arguments are stored as integers, convert other values explicitly");
+        int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+        LogRecord record{time, format, {(int64_t)args...}, 0, (uint8_t)level, (uint8_t)sizeof...(Args)};
+        getThreadRing().push(record);
+    }
+    void flush(); // writes all messages logged so far before returning
+
+private:
+    // constructor / desctructor
+    Logger();
+
+    // typical behaviour methods
+    LogRing &getThreadRing();
+    void releaseRing(LogRing *ring);
+    void drainLoop();
+    void drainOnce();
+
+    std::vector<std::unique_ptr<LogRing>> _rings; // rings of all threads which have logged
+    std::vector<LogRing *> _freeRings;            // rings of ended threads, reused by the next new threads
+    std::mutex _ringMutex;                        // protects _rings and _freeRings against threads logging for the first time or ending
+    std::mutex _outputMutex;                      // serializes draining between the drain thread and flush()
+    std::ostream *_out;                           // destination of all messages
+    std::vector<LogRecord> _batch;                // messages collected by the current drain
+    std::vector<uint64_t> _nReportedDrops;        // dropped messages already reported, per ring
+    std::chrono::steady_clock::time_point _start; // time origin of all messages
+    std::atomic<long> _samplingPeriod;
+    std::thread _drainThread;
+    std::mutex _drainMutex;
+    std::condition_variable _drainCondition;
+    bool _isStopping;                             // protected by _drainMutex
+};
+
+// logging macros, the arguments are not evaluated when the level is compiled out.
+// The _SAMPLED variants log only every n-th call of each call site, with n set by Logger::setSamplingPeriod.
+#define LOG_AT(level, ...) Logger::getInstance().log(level, __VA_ARGS__)
+#define LOG_SAMPLED_AT(level, ...)                                                    \
+    do                                                                                \
+    {                                                                                 \
+        static std::atomic<long> nCalls(0);                                           \
+        if (nCalls.fetch_add(1, std::memory_order_relaxed) % Logger::getInstance().getSamplingPeriod() == 0) \
+        {                                                                             \
+            LOG_AT(level, __VA_ARGS__);                                               \
+        }                                                                             \
+    } while (false)
+#define LOG_DISABLED(...) \
+    do                    \
+    {                     \
+    } while (false)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_DEBUG_SAMPLED(...) LOG_SAMPLED_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISABLED()
+#define LOG_DEBUG_SAMPLED(...) LOG_DISABLED()
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_INFO_SAMPLED(...) LOG_SAMPLED_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISABLED()
+#define LOG_INFO_SAMPLED(...) LOG_DISABLED()
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) LOG_DISABLED()
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_DISABLED()
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+#include <stdexcept>
+#include <fstream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "MappedFile.h"
+
+/* Implementation of class "MappedFile" */
+
+MappedFile::MappedFile(const std::string &filename)
+{
+    _data = nullptr;
+    _size = 0;
+    _isMapped = false;
+#if defined(__unix__) || defined(__APPLE__)
+    // map the whole file, the kernel pages in only what is read
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void *data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            _data = (const uint8_t *)data;
+            _size = info.st_size;
+            _isMapped = true;
+        }
+    }
+    ::close(fd);
+    if (_isMapped)
+    {
+        return;
+    }
+#endif
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+    _size = file.tellg();
+    _buffer.resize((_size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    file.seekg(0);
+    file.read((char *)_buffer.data(), _size);
+    _data = (const uint8_t *)_buffer.data();
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (_isMapped)
+    {
+        ::munmap((void *)_data, _size);
+    }
+#endif
+}
@@ -0,0 +1,31 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// read-only view of a whole file. The file is memory-mapped where the platform supports it, so opening
+// is independent of the file size and only the pages actually touched are read; elsewhere it is copied
+// into memory. The data is aligned to at least 8 bytes in both cases.
+class MappedFile
+{
+public:
+    // constructor / desctructor
+    MappedFile(const std::string &filename); // throws if the file cannot be read
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // getters / setters
+    const uint8_t *getData() const { return _data; }
+    size_t getSize() const { return _size; }
+
+private:
+    const uint8_t *_data;          // first byte of the file
+    size_t _size;                  // size of the file in bytes
+    bool _isMapped;                // data is a memory mapping rather than _buffer
+    std::vector<uint64_t> _buffer; // copy of the file where memory-mapping is not available
+};
+
+#endif
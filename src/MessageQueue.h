@@ -0,0 +1,234 @@
+#ifndef MESSAGEQUEUE_H
+#define MESSAGEQUEUE_H
+
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include "AtomicWait.h"
+
+// queue policy : unbounded std::deque guarded by a mutex, receivers block on a condition variable
+template <class T>
+class DequeQueue
+{
+public:
+    // typical behaviour methods
+    void send(T &&msg)
+    {
+        // add the message to the queue and afterwards send a notification
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(std::move(msg));
+        _condition.notify_one();
+    }
+
+    T receive()
+    {
+        // wait for new messages and pull them from the queue using move semantics
+        std::unique_lock<std::mutex> lck(_mutex);
+        _condition.wait(lck, [this] { return !_queue.empty(); });
+
+        T msg = std::move(_queue.front());
+        _queue.pop_front();
+        return msg;
+    }
+
+private:
+    std::deque<T> _queue;
+    std::condition_variable _condition;
+    std::mutex _mutex;
+};
+
+// queue policy : bounded lock-free ring buffer for many producers and a single consumer.
+// Every cell carries a sequence number which tells producers and the consumer wether the
+// cell is free or holds a message of the current lap. Blocking is done with futexes, so
+// neither side takes a lock and an uncontended send or receive issues no system call.
+template <class T>
+class MpscRingQueue
+{
+public:
+    // constructor / desctructor
+    MpscRingQueue(size_t capacity = 1024)
+    {
+        // round the capacity up to a power of two, so that positions map to cells with a mask
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        _mask = size - 1;
+        _cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        _tail = 0;
+        _head = 0;
+        _nPublished = 0;
+        _nConsumed = 0;
+        _nWaitingConsumers = 0;
+        _nWaitingProducers = 0;
+    }
+
+    // typical behaviour methods
+    void send(T &&msg)
+    {
+        // block while the ring is full, yielding a few times before going to sleep
+        for (int nRetries = 0; !tryPush(msg); nRetries++)
+        {
+            if (nRetries < _nSpinRetries)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            uint32_t nConsumed = _nConsumed.load();
+            _nWaitingProducers.fetch_add(1);
+            if (tryPush(msg))
+            {
+                _nWaitingProducers.fetch_sub(1);
+                break;
+            }
+            atomicWait(_nConsumed, nConsumed);
+            _nWaitingProducers.fetch_sub(1);
+        }
+        notifyConsumer();
+    }
+
+    T receive()
+    {
+        // block while the ring is empty, yielding a few times before going to sleep
+        T msg;
+        for (int nRetries = 0; !tryReceive(msg); nRetries++)
+        {
+            if (nRetries < _nSpinRetries)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            uint32_t nPublished = _nPublished.load();
+            _nWaitingConsumers.fetch_add(1);
+            if (tryReceive(msg))
+            {
+                _nWaitingConsumers.fetch_sub(1);
+                break;
+            }
+            atomicWait(_nPublished, nPublished);
+            _nWaitingConsumers.fetch_sub(1);
+        }
+
+        // wake up producers waiting for a free cell once half of the ring has been drained,
+        // since a producer only sleeps on a full ring this boundary is always reached again
+        if ((_head & (_mask >> 1)) == 0 && _nWaitingProducers.load() > 0)
+        {
+            _nConsumed.fetch_add(1);
+            atomicNotifyAll(_nConsumed);
+        }
+        return msg;
+    }
+
+    // moves msg into the ring and returns true, or leaves msg untouched and returns false if the ring is full
+    bool trySend(T &msg)
+    {
+        if (!tryPush(msg))
+        {
+            return false;
+        }
+        notifyConsumer();
+        return true;
+    }
+
+    // must only be called from the single consumer thread
+    bool tryReceive(T &msg)
+    {
+        Cell &cell = _cells[_head & _mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)sequence - (intptr_t)(_head + 1) < 0)
+        {
+            return false;
+        }
+
+        // take the message and hand the cell back to the producers for the next lap
+        msg = std::move(cell.data);
+        cell.sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    // typical behaviour methods
+
+    // claims a cell and moves msg into it without waking the consumer
+    bool tryPush(T &msg)
+    {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = _cells[pos & _mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0)
+            {
+                // the cell is free in this lap, try to claim it
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data = std::move(msg);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                // another producer claimed the cell, retry with the current tail
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void notifyConsumer()
+    {
+        // wake up the consumer only if it is actually asleep
+        _nPublished.fetch_add(1);
+        if (_nWaitingConsumers.load() > 0)
+        {
+            atomicNotifyOne(_nPublished);
+        }
+    }
+
+    static const int _nSpinRetries = 16;              // number of yields before a blocking call goes to sleep
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask;                                     // number of cells minus one
+    alignas(64) std::atomic<size_t> _tail;            // next position to be claimed by a producer
+    alignas(64) size_t _head;                         // next position to be read by the consumer
+    alignas(64) std::atomic<uint32_t> _nPublished;    // futex word bumped on every send
+    std::atomic<uint32_t> _nWaitingConsumers;         // number of consumers asleep on _nPublished
+    alignas(64) std::atomic<uint32_t> _nConsumed;     // futex word bumped whenever half of a full ring has been drained
+    std::atomic<uint32_t> _nWaitingProducers;         // number of producers asleep on _nConsumed
+};
+
+// thread-safe message queue whose storage and blocking strategy is selected by a queue policy
+template <class T, template <class> class QueuePolicy = DequeQueue>
+class MessageQueue
+{
+public:
+    // typical behaviour methods
+    void send(T &&msg) { _queue.send(std::move(msg)); }
+    T receive() { return _queue.receive(); }
+
+private:
+    QueuePolicy<T> _queue;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "Metrics.h"
+
+/* Implementation of class "HdrHistogram" */
+
+HdrHistogram::HdrHistogram()
+{
+    for (auto &bucket : _buckets)
+    {
+        bucket = 0;
+    }
+    _count = 0;
+    _sum = 0;
+}
+
+int HdrHistogram::getBucket(uint64_t value)
+{
+    if (value < (1u << subBits))
+    {
+        return (int)value;
+    }
+    // the leading bit selects the power of two, the next subBits bits the bucket within it
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = (int)(value >> (exponent - subBits)) & ((1 << subBits) - 1);
+    return ((exponent - subBits + 1) << subBits) + sub;
+}
+
+uint64_t HdrHistogram::getBucketUpperBound(int bucket)
+{
+    if (bucket < (1 << subBits))
+    {
+        return bucket;
+    }
+    int shift = (bucket >> subBits) - 1;
+    uint64_t lower = (uint64_t)((1 << subBits) + (bucket & ((1 << subBits) - 1))) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void HdrHistogram::addTo(HdrHistogram &total) const
+{
+    for (int b = 0; b < nBuckets; b++)
+    {
+        total._buckets[b].store(total.getBucketCount(b) + getBucketCount(b), std::memory_order_relaxed);
+    }
+    total._count.store(total.getCount() + getCount(), std::memory_order_relaxed);
+    total._sum.store(total.getSum() + getSum(), std::memory_order_relaxed);
+}
+
+uint64_t HdrHistogram::getQuantile(double q) const
+{
+    uint64_t count = getCount();
+    if (count == 0)
+    {
+        return 0;
+    }
+    // rank of the quantile, counted from 1
+    uint64_t rank = (uint64_t)(q * count);
+    rank = rank < 1 ? 1 : (rank > count ? count : rank);
+    uint64_t nSeen = 0;
+    for (int b = 0; b < nBuckets; b++)
+    {
+        nSeen += getBucketCount(b);
+        if (nSeen >= rank)
+        {
+            return getBucketUpperBound(b);
+        }
+    }
+    return getBucketUpperBound(nBuckets - 1);
+}
+
+uint64_t HdrHistogram::getCountAtMost(uint64_t value) const
+{
+    uint64_t count = 0;
+    for (int b = 0; b < nBuckets && getBucketUpperBound(b) <= value; b++)
+    {
+        count += getBucketCount(b);
+    }
+    return count;
+}
+
+/* Implementation of class "MetricShard" */
+
+MetricShard::MetricShard()
+{
+    for (auto &counter : _counters)
+    {
+        counter = 0;
+    }
+}
+
+void MetricShard::addTo(MetricShard &total) const
+{
+    for (int c = 0; c < nMetricCounters; c++)
+    {
+        total._counters[c].store(total.getCounter((MetricCounter)c) + getCounter((MetricCounter)c), std::memory_order_relaxed);
+    }
+    for (int h = 0; h < nMetricHistograms; h++)
+    {
+        _histograms[h].addTo(total._histograms[h]);
+    }
+}
+
+/* Implementation of class "Metrics" */
+
+Metrics &Metrics::getInstance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::aggregate(MetricShard &total)
+{
+    std::lock_guard<std::mutex> lock(_shardMutex);
+    for (auto &shard : _shards)
+    {
+        shard->addTo(total);
+    }
+}
+
+// returns the shard of the calling thread, taking one on its first record
+MetricShard &Metrics::getThreadShard()
+{
+    // hands the shard back when the thread ends, so that short-lived threads do not accumulate shards
+    struct ThreadShard
+    {
+        MetricShard *shard = nullptr;
+        ~ThreadShard()
+        {
+            if (shard)
+            {
+                Metrics::getInstance().releaseShard(shard);
+            }
+        }
+    };
+    static thread_local ThreadShard threadShard;
+
+    if (!threadShard.shard)
+    {
+        std::lock_guard<std::mutex> lock(_shardMutex);
+        if (_freeShards.empty())
+        {
+            _shards.emplace_back(new MetricShard());
+            threadShard.shard = _shards.back().get();
+        }
+        else
+        {
+            // values are cumulative, so the next thread simply keeps adding to them
+            threadShard.shard = _freeShards.back();
+            _freeShards.pop_back();
+        }
+    }
+    return *threadShard.shard;
+}
+
+void Metrics::releaseShard(MetricShard *shard)
+{
+    std::lock_guard<std::mutex> lock(_shardMutex);
+    _freeShards.push_back(shard);
+}
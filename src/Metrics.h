@@ -0,0 +1,125 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+// ids of all process-wide counters
+enum MetricCounter
+{
+    counterEntryRequests, // vehicles queued in front of an intersection
+    counterAdmissions,    // vehicles granted entry to an intersection
+    counterTicks,         // engine ticks
+    nMetricCounters,
+};
+
+// ids of all process-wide latency histograms, all values in ns
+enum MetricHistogram
+{
+    histogramEntryWait,    // from the entry request to the grant
+    histogramCrossing,     // from the grant to leaving the intersection
+    histogramRedLightWait, // from the arrival or the start of the latest red, whichever is later, to the grant
+    histogramTick,         // wall-clock duration of an engine tick
+    nMetricHistograms,
+};
+
+// HDR-style histogram of non-negative integers : values below 2^subBits have a bucket each, above that every power
+// of two is split into 2^subBits equal buckets, so any value is known to within 1/16 with a fixed array of buckets.
+// Recording is a single writer's plain increment, readers may aggregate concurrently.
+class HdrHistogram
+{
+public:
+    static const int subBits = 4;
+    static const int nBuckets = (64 - subBits + 1) << subBits;
+
+    // constructor / desctructor
+    HdrHistogram();
+
+    // getters / setters
+    uint64_t getCount() const { return _count.load(std::memory_order_relaxed); }
+    uint64_t getSum() const { return _sum.load(std::memory_order_relaxed); }
+    uint64_t getBucketCount(int bucket) const { return _buckets[bucket].load(std::memory_order_relaxed); }
+    static int getBucket(uint64_t value);
+    static uint64_t getBucketUpperBound(int bucket);
+
+    // typical behaviour methods
+    void record(uint64_t value)
+    {
+        increment(_buckets[getBucket(value)], 1);
+        increment(_count, 1);
+        increment(_sum, value);
+    }
+    void addTo(HdrHistogram &total) const;    // adds all buckets to a histogram which is not written concurrently
+    uint64_t getQuantile(double q) const;     // upper bound of the bucket holding the q-quantile
+    uint64_t getCountAtMost(uint64_t value) const; // number of values in buckets ending at or below value
+
+private:
+    // only the owning thread writes, so a relaxed load and store replace the locked read-modify-write
+    static void increment(std::atomic<uint64_t> &counter, uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> _buckets[nBuckets];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+
+    friend class MetricShard;
+};
+
+// auxiliary class holding the counters and histograms written by a single thread
+class MetricShard
+{
+public:
+    // constructor / desctructor
+    MetricShard();
+
+    // typical behaviour methods
+    void increment(MetricCounter counter, uint64_t n) { HdrHistogram::increment(_counters[counter], n); }
+    void record(MetricHistogram histogram, uint64_t value) { _histograms[histogram].record(value); }
+    void addTo(MetricShard &total) const;
+    uint64_t getCounter(MetricCounter counter) const { return _counters[counter].load(std::memory_order_relaxed); }
+    const HdrHistogram &getHistogram(MetricHistogram histogram) const { return _histograms[histogram]; }
+
+private:
+    std::atomic<uint64_t> _counters[nMetricCounters];
+    HdrHistogram _histograms[nMetricHistograms];
+};
+
+// process-wide registry of hot-path metrics : every thread writes into a shard of its own, so recording takes
+// no lock and shares no cache line, and readers sum all shards while the simulation keeps running
+class Metrics
+{
+public:
+    // constructor / desctructor
+    static Metrics &getInstance();
+
+    // getters / setters
+    static int64_t getWallClock() // steady clock in ns
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // typical behaviour methods
+    void increment(MetricCounter counter, uint64_t n = 1) { getThreadShard().increment(counter, n); }
+    void record(MetricHistogram histogram, int64_t value) { getThreadShard().record(histogram, value > 0 ? value : 0); }
+    void aggregate(MetricShard &total); // sums all shards into a shard which must be zero
+
+private:
+    // constructor / desctructor
+    Metrics() {}
+
+    // typical behaviour methods
+    MetricShard &getThreadShard();
+    void releaseShard(MetricShard *shard);
+
+    std::vector<std::unique_ptr<MetricShard>> _shards; // shards of all threads which have recorded, their values are cumulative
+    std::vector<MetricShard *> _freeShards;            // shards of ended threads, continued by the next new threads
+    std::mutex _shardMutex;                            // protects _shards and _freeShards
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include <fstream>
+#include <cstdio>
+#include "MetricsExporter.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "World.h"
+
+/* Implementation of class "MetricsExporter" */
+
+MetricsExporter::MetricsExporter(World &world, const std::string &filename, double interval) : _world(world)
+{
+    _filename = filename;
+    _interval = interval;
+    _isStopping = false;
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    finish();
+}
+
+void MetricsExporter::start()
+{
+    _thread = std::thread(&MetricsExporter::run, this);
+}
+
+void MetricsExporter::finish()
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+    _condition.notify_one();
+    _thread.join();
+    dump();
+}
+
+void MetricsExporter::run()
+{
+    std::unique_lock<std::mutex> lck(_mutex);
+    while (!_condition.wait_for(lck, std::chrono::duration<double>(_interval), [this] { return _isStopping; }))
+    {
+        lck.unlock();
+        dump();
+        lck.lock();
+    }
+}
+
+// writes into a temporary file first, so that a scraper never reads a partial dump
+void MetricsExporter::dump()
+{
+    std::string tmpFilename = _filename + ".tmp";
+    {
+        std::ofstream out(tmpFilename);
+        if (!out)
+        {
+            LOG_ERROR("MetricsExporter: cannot write the temporary metrics file");
+            return;
+        }
+        write(out);
+    }
+    std::rename(tmpFilename.c_str(), _filename.c_str());
+}
+
+void MetricsExporter::write(std::ostream &out)
+{
+    MetricShard total;
+    Metrics::getInstance().aggregate(total);
+
+    static const struct
+    {
+        MetricCounter id;
+        const char *name;
+        const char *help;
+    } counters[] = {
+        {counterEntryRequests, "traffic_entry_requests_total", "Vehicles queued in front of an intersection."},
+        {counterAdmissions, "traffic_admissions_total", "Vehicles granted entry to an intersection."},
+        {counterTicks, "traffic_ticks_total", "Engine ticks completed."},
+    };
+    for (auto &counter : counters)
+    {
+        out << "# HELP " << counter.name << " " << counter.help << "\n";
+        out << "# TYPE " << counter.name << " counter\n";
+        out << counter.name << " " << total.getCounter(counter.id) << "\n";
+    }
+
+    // waits of queued vehicles are measured in simulated time when a scheduler drives the intersections
+    static const struct
+    {
+        MetricHistogram id;
+        const char *name;
+        const char *help;
+    } histograms[] = {
+        {histogramEntryWait, "traffic_entry_wait_seconds", "Time from an entry request to the grant, simulated time in engine mode."},
+        {histogramCrossing, "traffic_crossing_seconds", "Time from the grant to leaving the intersection, simulated time in engine mode."},
+        {histogramRedLightWait, "traffic_red_light_wait_seconds", "Time from the arrival of a vehicle or the start of the latest red of its approach, whichever is later, to its admission, for every vehicle which has waited at a red light, simulated time in engine mode."},
+        {histogramTick, "traffic_tick_seconds", "Wall-clock duration of an engine tick, without real-time pacing."},
+    };
+    static const double bounds[] = {1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 0.1, 1.0, 10.0, 100.0, 1000.0};
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (auto &histogram : histograms)
+    {
+        // bucket counts are exact to within the 1/16 resolution of the underlying HDR buckets
+        const HdrHistogram &values = total.getHistogram(histogram.id);
+        out << "# HELP " << histogram.name << " " << histogram.help << "\n";
+        out << "# TYPE " << histogram.name << " histogram\n";
+        for (double bound : bounds)
+        {
+            out << histogram.name << "_bucket{le=\"" << bound << "\"} " << values.getCountAtMost(bound * 1e9) << "\n";
+        }
+        out << histogram.name << "_bucket{le=\"+Inf\"} " << values.getCount() << "\n";
+        out << histogram.name << "_sum " << values.getSum() * 1e-9 << "\n";
+        out << histogram.name << "_count " << values.getCount() << "\n";
+
+        out << "# HELP " << histogram.name << "_quantile Upper bound of the quantile, within 1/16.\n";
+        out << "# TYPE " << histogram.name << "_quantile gauge\n";
+        for (double q : quantiles)
+        {
+            out << histogram.name << "_quantile{quantile=\"" << q << "\"} " << values.getQuantile(q) * 1e-9 << "\n";
+        }
+    }
+
+    // per-intersection values, each one read without stopping the intersection
+    auto &intersections = _world.getIntersections();
+    out << "# HELP traffic_intersection_queue_length Vehicles waiting to enter the intersection on all approaches.\n";
+    out << "# TYPE traffic_intersection_queue_length gauge\n";
+    for (auto &intersection : intersections)
+    {
+        out << "traffic_intersection_queue_length{intersection=\"" << intersection->getID() << "\"} " << intersection->getQueueLength() << "\n";
+    }
+    out << "# HELP traffic_intersection_queue_length_max Longest queue of a single approach so far.\n";
+    out << "# TYPE traffic_intersection_queue_length_max gauge\n";
+    for (auto &intersection : intersections)
+    {
+        out << "traffic_intersection_queue_length_max{intersection=\"" << intersection->getID() << "\"} " << intersection->getMaxQueueLength() << "\n";
+    }
+    out << "# HELP traffic_intersection_admissions_total Vehicles granted entry.\n";
+    out << "# TYPE traffic_intersection_admissions_total counter\n";
+    for (auto &intersection : intersections)
+    {
+        out << "traffic_intersection_admissions_total{intersection=\"" << intersection->getID() << "\"} " << intersection->getNumAdmissions() << "\n";
+    }
+    out << "# HELP traffic_intersection_entry_wait_seconds_total Sum of the waits of all admitted vehicles.\n";
+    out << "# TYPE traffic_intersection_entry_wait_seconds_total counter\n";
+    for (auto &intersection : intersections)
+    {
+        out << "traffic_intersection_entry_wait_seconds_total{intersection=\"" << intersection->getID() << "\"} " << intersection->getTotalEntryWait() * 1e-9 << "\n";
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+
+// forward declarations to avoid include cycle
+class World;
+
+// periodically writes all metrics in the Prometheus text format, e.g. for the textfile collector of node_exporter.
+// Runs on a thread of its own and only reads, so the simulation is never stopped for a dump.
+class MetricsExporter
+{
+public:
+    // constructor / desctructor
+    MetricsExporter(World &world, const std::string &filename, double interval);
+    ~MetricsExporter();
+
+    // typical behaviour methods
+    void start();
+    void finish(); // stops the periodic dumps and writes a final one
+    void write(std::ostream &out);
+
+private:
+    // typical behaviour methods
+    void run();
+    void dump();
+
+    World &_world;             // intersections reported with per-intersection metrics
+    std::string _filename;     // replaced atomically by every dump
+    double _interval;          // wall-clock time between two dumps in s
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _isStopping;          // protected by _mutex
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+
+#include <cstdint>
+
+// counter-based random number stream : the n-th number of a stream is a pure function of
+// (seed, stream id, n), computed with the SplitMix64 finalizer. A stream needs 16 bytes of state,
+// streams with different ids are independent of each other, and the same seed reproduces the
+// same numbers bit for bit regardless of which thread draws them.
+class RandomStream
+{
+public:
+    // constructor / desctructor
+    RandomStream(uint64_t seed = 0, uint64_t streamID = 0)
+    {
+        _key = mix(seed ^ mix(streamID + 0x632BE59BD9B4E019ull));
+        _counter = 0;
+    }
+
+    // getters / setters
+    uint64_t getKey() { return _key; }
+    uint64_t getCounter() { return _counter; }
+    void setState(uint64_t key, uint64_t counter) // continues a stream saved with getKey() and getCounter()
+    {
+        _key = key;
+        _counter = counter;
+    }
+
+    // typical behaviour methods
+    uint64_t next()
+    {
+        return mix(_key + ++_counter * 0x9E3779B97F4A7C15ull);
+    }
+
+    // returns an integer uniformly distributed in [0, n)
+    int uniformInt(int n)
+    {
+        // multiply-shift maps 32 random bits to the range without a division
+        return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+    }
+
+    // returns a real number uniformly distributed in [a, b)
+    double uniformReal(double a, double b)
+    {
+        return a + (next() >> 11) * (1.0 / 9007199254740992.0) * (b - a);
+    }
+
+private:
+    static uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t _key;     // derived from seed and stream id
+    uint64_t _counter; // number of values drawn so far
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <numeric>
+#include "World.h"
+#include "RegionPartition.h"
+
+void RegionPartition::build(World &world, int nRegions)
+{
+    std::vector<std::shared_ptr<Intersection>> &intersections = world.getIntersections();
+    _nRegions = nRegions;
+    _regions.assign(intersections.size(), 0);
+    _posX.resize(intersections.size());
+    _posY.resize(intersections.size());
+    for (size_t i = 0; i < intersections.size(); i++)
+    {
+        intersections[i]->getPosition(_posX[i], _posY[i]);
+    }
+
+    std::vector<int> ids(intersections.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    bisect(ids.begin(), ids.end(), 0, nRegions);
+
+    _posX.clear();
+    _posY.clear();
+}
+
+// assigns the intersections in [first, last) to the regions [firstRegion, firstRegion + nRegions)
+void RegionPartition::bisect(std::vector<int>::iterator first, std::vector<int>::iterator last, int firstRegion, int nRegions)
+{
+    if (nRegions == 1 || first == last)
+    {
+        std::for_each(first, last, [this, firstRegion](int id) { _regions[id] = firstRegion; });
+        return;
+    }
+
+    // split along the longer side of the bounding box
+    double minX = _posX[*first], maxX = minX, minY = _posY[*first], maxY = minY;
+    for (auto it = first; it != last; it++)
+    {
+        minX = std::min(minX, _posX[*it]);
+        maxX = std::max(maxX, _posX[*it]);
+        minY = std::min(minY, _posY[*it]);
+        maxY = std::max(maxY, _posY[*it]);
+    }
+    const std::vector<double> &pos = maxX - minX >= maxY - minY ? _posX : _posY;
+
+    // both halves receive intersections in proportion to their number of regions, ties are broken by id
+    int nFirst = nRegions / 2;
+    auto middle = first + (last - first) * nFirst / nRegions;
+    std::nth_element(first, middle, last, [&pos](int a, int b) {
+        return pos[a] < pos[b] || (pos[a] == pos[b] && a < b);
+    });
+    bisect(first, middle, firstRegion, nFirst);
+    bisect(middle, last, firstRegion + nFirst, nRegions - nFirst);
+}
@@ -0,0 +1,32 @@
+#ifndef REGIONPARTITION_H
+#define REGIONPARTITION_H
+
+#include <vector>
+
+// forward declarations to avoid include cycle
+class World;
+
+// assignment of every intersection to one of a fixed number of spatially compact regions, found by
+// recursive coordinate bisection of the intersection positions : the intersections are split along
+// the longer side of their bounding box until there is one group per region. Regions receive equal
+// numbers of intersections, and streets mostly connect intersections of the same region.
+class RegionPartition
+{
+public:
+    // getters / setters
+    int getNumRegions() const { return _nRegions; }
+    int getRegion(int intersectionID) const { return _regions[intersectionID]; }
+
+    // typical behaviour methods
+    void build(World &world, int nRegions);
+
+private:
+    // typical behaviour methods
+    void bisect(std::vector<int>::iterator first, std::vector<int>::iterator last, int firstRegion, int nRegions);
+
+    int _nRegions = 0;                        // number of regions
+    std::vector<int> _regions;                // region of every intersection, indexed by intersection id
+    std::vector<double> _posX, _posY;         // intersection positions while building
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <map>
+#include <cmath>
+#include "World.h"
+#include "RoadGraph.h"
+#include "TrafficLight.h"
+
+void RoadGraph::build(World &world)
+{
+    std::vector<std::shared_ptr<Street>> &streets = world.getStreets();
+    size_t nIntersections = world.getIntersections().size();
+
+    // count the edges of every intersection, each street contributes one edge to both of its ends
+    _offsets.assign(nIntersections + 1, 0);
+    for (auto &street : streets)
+    {
+        _offsets[street->getInIntersectionID() + 1]++;
+        _offsets[street->getOutIntersectionID() + 1]++;
+    }
+    for (size_t i = 0; i < nIntersections; i++)
+    {
+        _offsets[i + 1] += _offsets[i];
+    }
+
+    // fill the spans in street order, which is the order in which streets were connected
+    _edges.resize(_offsets[nIntersections]);
+    std::vector<int> fill(_offsets.begin(), _offsets.end() - 1);
+    for (auto &street : streets)
+    {
+        int in = street->getInIntersectionID(), out = street->getOutIntersectionID();
+        double xIn, yIn, xOut, yOut;
+        world.getIntersection(in).getPosition(xIn, yIn);
+        world.getIntersection(out).getPosition(xOut, yOut);
+
+        _edges[fill[in]++] = RoadEdge{street->getID(), out, street->getLength(), xIn, yIn, xOut, yOut};
+        _edges[fill[out]++] = RoadEdge{street->getID(), in, street->getLength(), xOut, yOut, xIn, yIn};
+    }
+
+    // precompute the stages and conflicts of all intersections, so that admission only looks them up. The conflicts
+    // only depend on the order of the streets around an intersection, so intersections with the same order share them.
+    _approachStages.resize(_edges.size());
+    _conflictOffsets.resize(nIntersections);
+    _conflicts.clear();
+    std::map<std::vector<int>, size_t> conflictOffsets; // conflict matrix of every order of streets seen so far
+    std::vector<int> order, ranks;
+    for (size_t i = 0; i < nIntersections; i++)
+    {
+        rankApproaches(i, order, ranks);
+        auto matrix = conflictOffsets.emplace(ranks, _conflicts.size());
+        if (matrix.second)
+        {
+            int degree = getDegree(i);
+            _conflicts.resize(_conflicts.size() + (size_t)degree * degree * getNumConflictWords(degree), 0);
+            buildConflicts(ranks, _conflicts.data() + matrix.first->second);
+        }
+        _conflictOffsets[i] = matrix.first->second;
+    }
+}
+
+// approaches of an intersection are numbered like its edges, order is scratch space
+void RoadGraph::rankApproaches(int intersectionID, std::vector<int> &order, std::vector<int> &ranks)
+{
+    int degree = getDegree(intersectionID);
+    const RoadEdge *edges = getEdges(intersectionID);
+
+    // rank the approaches counter-clockwise by the direction in which their streets leave, the pixel y axis points down
+    order.resize(degree);
+    ranks.resize(degree);
+    std::iota(order.begin(), order.end(), 0);
+    auto getAngle = [edges](int e) { return std::atan2(edges[e].y1 - edges[e].y2, edges[e].x2 - edges[e].x1); };
+    std::stable_sort(order.begin(), order.end(), [&getAngle](int a, int b) { return getAngle(a) < getAngle(b); });
+    for (int r = 0; r < degree; r++)
+    {
+        ranks[order[r]] = r;
+    }
+
+    // alternate the stages around the intersection, so that opposite approaches of a crossing share their green
+    int *stages = _approachStages.data() + _offsets[intersectionID];
+    for (int approach = 0; approach < degree; approach++)
+    {
+        stages[approach] = ranks[approach] % TrafficLight::nStages;
+    }
+}
+
+// fills the zeroed conflict matrix of an intersection whose approaches have the given ranks
+void RoadGraph::buildConflicts(const std::vector<int> &ranks, uint64_t *conflicts)
+{
+    int degree = ranks.size();
+    int nWords = getNumConflictWords(degree);
+    for (int approach = 0; approach < degree; approach++)
+    {
+        for (int exit = 0; exit < degree; exit++)
+        {
+            for (int otherApproach = 0; otherApproach < degree; otherApproach++)
+            {
+                for (int otherExit = 0; otherExit < degree; otherExit++)
+                {
+                    if (crossesPath(approach, exit, otherApproach, otherExit, ranks))
+                    {
+                        int movement = approach * degree + exit, otherMovement = otherApproach * degree + otherExit;
+                        conflicts[movement * nWords + otherMovement / 64] |= (uint64_t)1 << (otherMovement % 64);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// two movements conflict when they merge into the same street or when their paths cross. Vehicles drive on the right,
+// so every street meets the intersection with its incoming lanes counter-clockwise of its outgoing lanes, and the path
+// of a movement is the chord between both points on a circle around the intersection : two chords cross if exactly one
+// end of the other lies between the ends of the first. A u-turn is taken to block the whole intersection.
+bool RoadGraph::crossesPath(int approach, int exit, int otherApproach, int otherExit, const std::vector<int> &ranks)
+{
+    if (exit == otherExit || approach == exit || otherApproach == otherExit)
+    {
+        return true;
+    }
+    if (approach == otherApproach)
+    {
+        return false;
+    }
+    int nPoints = 2 * ranks.size();
+    int from = 2 * ranks[approach] + 1, to = 2 * ranks[exit];
+    auto isBetween = [from, to, nPoints](int point) { return (point - from + nPoints) % nPoints < (to - from + nPoints) % nPoints; };
+    return isBetween(2 * ranks[otherApproach] + 1) != isBetween(2 * ranks[otherExit]);
+}
+
+// returns the edge which leaves the given intersection along the given street
+const RoadEdge &RoadGraph::findEdge(int fromID, int streetID) const
+{
+    const RoadEdge *edges = getEdges(fromID);
+    for (int e = 0; e < getDegree(fromID); e++)
+    {
+        if (edges[e].streetID == streetID)
+        {
+            return edges[e];
+        }
+    }
+    throw std::invalid_argument("street is not connected to intersection");
+}
@@ -0,0 +1,77 @@
+#ifndef ROADGRAPH_H
+#define ROADGRAPH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// forward declarations to avoid include cycle
+class World;
+
+// directed view of a street as seen from one of its intersections
+struct RoadEdge
+{
+    int streetID;   // street leaving the intersection
+    int otherID;    // intersection at the other end of the street
+    double length;  // length of the street in m
+    double x1, y1;  // pixel position of the intersection the edge leaves from
+    double x2, y2;  // pixel position of the intersection at the other end
+};
+
+// immutable compressed-sparse-row adjacency of the road network : the edges leaving intersection i
+// are stored contiguously in _edges[_offsets[i], _offsets[i + 1]), so routing decisions are a span
+// lookup without any heap allocation. Must be rebuilt whenever streets or intersections change.
+// It also holds what intersections derive from their geometry, so that worlds sharing a graph share that too.
+class RoadGraph
+{
+public:
+    // getters / setters
+    int getDegree(int intersectionID) const { return _offsets[intersectionID + 1] - _offsets[intersectionID]; }
+    const RoadEdge *getEdges(int intersectionID) const { return _edges.data() + _offsets[intersectionID]; }
+
+    // number of streets a vehicle arriving at the intersection can choose from
+    int getNumChoices(int intersectionID) const
+    {
+        int degree = getDegree(intersectionID);
+        return degree > 1 ? degree - 1 : degree;
+    }
+
+    // returns the choice-th edge leaving the intersection, skipping the street the vehicle arrives on
+    // (at a dead-end the only choice is to drive back the same way)
+    const RoadEdge &getChoice(int intersectionID, int incomingStreetID, int choice) const
+    {
+        const RoadEdge *edges = getEdges(intersectionID);
+        int degree = getDegree(intersectionID);
+        if (degree > 1 && edges[choice].streetID == incomingStreetID)
+        {
+            return edges[degree - 1];
+        }
+        return edges[choice];
+    }
+
+    // stage of the traffic light which gives green to the vehicles arriving along every edge, indexed like getEdges
+    const int *getApproachStages(int intersectionID) const { return _approachStages.data() + _offsets[intersectionID]; }
+
+    // bit matrix of the conflicting movements at an intersection, with a row of getNumConflictWords words for
+    // every movement from the street of edge a to the street of edge b, which has the index a * degree + b
+    const uint64_t *getConflicts(int intersectionID) const { return _conflicts.data() + _conflictOffsets[intersectionID]; }
+    static int getNumConflictWords(int degree) { return (degree * degree + 63) / 64; }
+
+    // typical behaviour methods
+    void build(World &world);
+    const RoadEdge &findEdge(int fromID, int streetID) const;
+
+private:
+    // typical behaviour methods
+    void rankApproaches(int intersectionID, std::vector<int> &order, std::vector<int> &ranks);
+    static void buildConflicts(const std::vector<int> &ranks, uint64_t *conflicts);
+    static bool crossesPath(int approach, int exit, int otherApproach, int otherExit, const std::vector<int> &ranks);
+
+    std::vector<int> _offsets;            // start of the edge span of every intersection, plus one end marker
+    std::vector<RoadEdge> _edges;         // edges of all intersections, grouped by the intersection they leave from
+    std::vector<int> _approachStages;     // stage of every edge as seen by the vehicles arriving along it
+    std::vector<size_t> _conflictOffsets; // start of the conflict matrix of every intersection within _conflicts
+    std::vector<uint64_t> _conflicts;     // conflict matrices of all distinct orders of streets around an intersection
+};
+
+#endif
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include "World.h"
+#include "Scheduler.h"
+#include "Metrics.h"
+
+/* Implementation of class "Barrier" */
+
+Barrier::Barrier(int nThreads)
+{
+    _nThreads = nThreads;
+    _nWaiting = 0;
+    _generation = 0;
+}
+
+void Barrier::arriveAndWait()
+{
+    std::unique_lock<std::mutex> lck(_mutex);
+
+    // the last thread to arrive releases all others and opens the next generation
+    unsigned long generation = _generation;
+    if (++_nWaiting == _nThreads)
+    {
+        _nWaiting = 0;
+        _generation++;
+        lck.unlock();
+        _condition.notify_all();
+        return;
+    }
+
+    _condition.wait(lck, [this, generation] { return generation != _generation; });
+}
+
+/* Implementation of class "Scheduler" */
+
+Scheduler::Scheduler(World &world) : _world(world)
+{
+    _tickDuration = 0.001; // in s
+    _isRealTime = true;
+    _endTime = 0.0;
+    _nWorkers = std::max(1u, std::thread::hardware_concurrency());
+    _isRunning = false;
+    _isStopping = false;
+    _tickCount = 0;
+
+    // let intersections signal arrivals and departures to this scheduler
+    for (auto &intersection : _world.getIntersections())
+    {
+        intersection->setScheduler(this);
+    }
+}
+
+Scheduler::~Scheduler()
+{
+    stop();
+
+    // fall back to thread-per-object signalling, so the world may outlive this scheduler
+    for (auto &intersection : _world.getIntersections())
+    {
+        intersection->setScheduler(nullptr);
+    }
+}
+
+void Scheduler::addFrameCallback(double frameInterval, std::function<void(double)> callback)
+{
+    _frameCallbacks.push_back(FrameCallback{callback, frameInterval, 0});
+}
+
+// partitions the road network into one region per worker
+void Scheduler::createRegions()
+{
+    _partition.build(_world, _nWorkers);
+    for (int r = 0; r < _nWorkers; r++)
+    {
+        _regions.emplace_back(new Region());
+        _regions.back()->handoffs.resize(_nWorkers);
+    }
+    for (auto &intersection : _world.getIntersections())
+    {
+        _regions[_partition.getRegion(intersection->getID())]->intersections.push_back(intersection.get());
+    }
+}
+
+// moves the motion state of a vehicle into the table of the region it is heading for
+void Scheduler::attachVehicle(Vehicle &vehicle)
+{
+    VehicleTable &table = _regions[_partition.getRegion(vehicle.getCurrentDestinationID())]->vehicles;
+    vehicle.attachToTable(&table, table.addVehicle(vehicle.getID()));
+}
+
+void Scheduler::buildRegions()
+{
+    createRegions();
+    for (auto &vehicle : _world.getVehicles())
+    {
+        attachVehicle(*vehicle);
+    }
+
+    // vehicles starting on the same street line up in the order of their ids
+    for (auto &vehicle : _world.getVehicles())
+    {
+        vehicle->enterLane();
+    }
+}
+
+void Scheduler::getVehicleOrder(std::vector<int> &vehicleIDs)
+{
+    vehicleIDs.clear();
+    for (auto &region : _regions)
+    {
+        for (size_t slot = 0; slot < region->vehicles.getSize(); slot++)
+        {
+            vehicleIDs.push_back(region->vehicles.getVehicleID(slot));
+        }
+    }
+}
+
+// attaches the vehicles in their saved order, so that a run with as many workers as the saved one advances its rows in
+// the same order and continues bit for bit. Intersections must have been restored before, vehicles and lanes are
+// restored afterwards (see Checkpoint), frame callbacks must have been added before.
+void Scheduler::restore(long tickCount, const std::vector<int> &vehicleIDs)
+{
+    if (!_regions.empty())
+    {
+        throw std::logic_error("Scheduler::restore: the simulation has already been started");
+    }
+    createRegions();
+    for (int vehicleID : vehicleIDs)
+    {
+        attachVehicle(_world.getVehicle(vehicleID));
+    }
+    _tickCount = tickCount;
+
+    // frames up to the saved time have been delivered by the saved run
+    for (FrameCallback &frameCallback : _frameCallbacks)
+    {
+        while (frameCallback.frameInterval > 0.0 && getSimulationTime() >= frameCallback.nFrames * frameCallback.frameInterval)
+        {
+            frameCallback.nFrames++;
+        }
+    }
+
+    // wake up the intersections whose vehicles wait for a light which has not turned green yet
+    for (auto &intersection : _world.getIntersections())
+    {
+        double wakeUpTime = intersection->getWakeUpTime();
+        if (wakeUpTime >= 0.0 && std::ceil(wakeUpTime / _tickDuration - 1e-9) >= _tickCount)
+        {
+            signalIntersectionAt(intersection.get(), wakeUpTime);
+        }
+    }
+}
+
+void Scheduler::simulate()
+{
+    if (_regions.empty())
+    {
+        buildRegions();
+    }
+
+    // launch the worker pool
+    _isRunning = true;
+    _barrier.reset(new Barrier(_nWorkers));
+    for (int w = 0; w < _nWorkers; w++)
+    {
+        _threads.emplace_back(std::thread(&Scheduler::runWorker, this, w));
+    }
+}
+
+// the calling thread takes the place of the worker pool, so many schedulers can share the threads of their caller
+void Scheduler::run()
+{
+    if (_regions.empty())
+    {
+        _nWorkers = 1;
+        buildRegions();
+    }
+    if (_nWorkers != 1)
+    {
+        throw std::logic_error("Scheduler::run: regions have been built for a pool of workers");
+    }
+    _isRunning = true;
+    _barrier.reset(new Barrier(1));
+    runWorker(0);
+}
+
+void Scheduler::stop()
+{
+    // let the workers finish the current tick before joining them
+    _isRunning = false;
+    waitUntilFinished();
+}
+
+void Scheduler::waitUntilFinished()
+{
+    std::for_each(_threads.begin(), _threads.end(), [](std::thread &t) {
+        t.join();
+    });
+    _threads.clear();
+}
+
+void Scheduler::signalIntersection(Intersection *intersection)
+{
+    // arrivals, departures and phase changes all happen on the worker owning the intersection, so no lock is needed
+    _regions[_partition.getRegion(intersection->getID())]->signalledIntersections.push_back(intersection);
+}
+
+void Scheduler::signalIntersectionAt(Intersection *intersection, double time)
+{
+    // the first tick which starts at or after the given time
+    long tick = std::ceil(time / _tickDuration - 1e-9);
+    std::vector<WakeUp> &wakeUps = _regions[_partition.getRegion(intersection->getID())]->wakeUps;
+    wakeUps.push_back(WakeUp{tick, intersection});
+    std::push_heap(wakeUps.begin(), wakeUps.end(), std::greater<WakeUp>());
+}
+
+// moves the rows of all vehicles which turned towards another region into the handoff buffers of this region
+void Scheduler::handOffLeavingVehicles(Region &region)
+{
+    // from the back, so that filling a hole only ever moves a row which stays in this region
+    VehicleRow row;
+    for (auto slot = region.leavingSlots.rbegin(); slot != region.leavingSlots.rend(); slot++)
+    {
+        region.vehicles.getRow(*slot, row);
+        int destinationID = _world.getVehicle(row.vehicleID).getCurrentDestinationID();
+        region.handoffs[_partition.getRegion(destinationID)].push_back(row);
+
+        int movedID = region.vehicles.removeRow(*slot);
+        if (movedID >= 0)
+        {
+            _world.getVehicle(movedID).followRow(&region.vehicles, *slot);
+        }
+    }
+    region.leavingSlots.clear();
+}
+
+// appends the rows handed over by all other regions in the previous phase
+void Scheduler::acceptHandoffs(int regionIdx)
+{
+    Region &region = *_regions[regionIdx];
+    for (auto &other : _regions)
+    {
+        for (const VehicleRow &row : other->handoffs[regionIdx])
+        {
+            _world.getVehicle(row.vehicleID).followRow(&region.vehicles, region.vehicles.addRow(row));
+            region.enteringVehicles.push_back(row.vehicleID);
+        }
+        other->handoffs[regionIdx].clear();
+    }
+}
+
+// function which is executed by every worker thread
+void Scheduler::runWorker(int workerIdx)
+{
+    // every worker owns the vehicles and intersections of one region, vehicles which leave it are handed over at the end of phase 1
+    Region &region = *_regions[workerIdx];
+
+    auto tickDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(_tickDuration));
+    auto nextTick = std::chrono::steady_clock::now() + tickDuration;
+    while (true)
+    {
+        int64_t tickStart = Metrics::getWallClock();
+
+        // phase 1 : signal the intersections whose light has turned green and advance vehicles, which may signal
+        // intersections of this region. Lights are evaluated lazily from the virtual clock, so they cost nothing here
+        while (!region.wakeUps.empty() && region.wakeUps.front().tick <= _tickCount)
+        {
+            region.wakeUps.front().intersection->signalAdmission();
+            std::pop_heap(region.wakeUps.begin(), region.wakeUps.end(), std::greater<WakeUp>());
+            region.wakeUps.pop_back();
+        }
+        for (size_t slot = 0; slot < region.vehicles.getSize(); slot++)
+        {
+            _world.getVehicle(region.vehicles.getVehicleID(slot)).updateObstacle();
+        }
+        region.vehicles.integrate(_tickDuration, 0, region.vehicles.getSize());
+        for (size_t slot = 0; slot < region.vehicles.getSize(); slot++)
+        {
+            Vehicle &vehicle = _world.getVehicle(region.vehicles.getVehicleID(slot));
+            vehicle.step();
+            if (!vehicle.isInLane())
+            {
+                // the lanes of the new street belong to the region of the new destination
+                if (_partition.getRegion(vehicle.getCurrentDestinationID()) != workerIdx)
+                {
+                    region.leavingSlots.push_back(slot);
+                }
+                else
+                {
+                    region.enteringVehicles.push_back(vehicle.getID());
+                }
+            }
+        }
+        handOffLeavingVehicles(region);
+        _barrier->arriveAndWait();
+
+        // phase 2 : take over arriving vehicles, line up all vehicles which turned into a street of this region in
+        // the order of their ids and let signalled intersections grant entry to waiting vehicles, idle intersections cost nothing
+        acceptHandoffs(workerIdx);
+        std::sort(region.enteringVehicles.begin(), region.enteringVehicles.end());
+        for (int vehicleID : region.enteringVehicles)
+        {
+            _world.getVehicle(vehicleID).enterLane();
+        }
+        region.enteringVehicles.clear();
+        for (Intersection *intersection : region.signalledIntersections)
+        {
+            intersection->step();
+        }
+        region.signalledIntersections.clear();
+        _barrier->arriveAndWait();
+
+        // phase 3 : advance the virtual clock, keep it in line with wall-clock time in real-time mode,
+        // decide wether to continue and publish a snapshot or capture a frame
+        if (workerIdx == 0)
+        {
+            // both barriers have been passed, so this is the duration of the slowest worker, without any pacing
+            Metrics::getInstance().record(histogramTick, Metrics::getWallClock() - tickStart);
+            Metrics::getInstance().increment(counterTicks);
+            _tickCount++;
+            if (_isRealTime)
+            {
+                std::this_thread::sleep_until(nextTick);
+                nextTick += tickDuration;
+            }
+            _isStopping = !_isRunning || (_endTime > 0.0 && getSimulationTime() >= _endTime);
+
+            // hand a consistent state to the renderer, all other workers are waiting at the barrier
+            _world.publishSnapshot(getSimulationTime());
+            for (FrameCallback &frameCallback : _frameCallbacks)
+            {
+                if (getSimulationTime() >= frameCallback.nFrames * frameCallback.frameInterval)
+                {
+                    frameCallback.callback(getSimulationTime());
+                    frameCallback.nFrames++;
+                }
+            }
+        }
+        _barrier->arriveAndWait();
+
+        if (_isStopping)
+        {
+            break;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include "VehicleTable.h"
+#include "RegionPartition.h"
+
+// forward declarations to avoid include cycle
+class Intersection;
+class Vehicle;
+class World;
+
+// auxiliary class to let a fixed number of worker threads wait for each other at the end of a tick phase
+class Barrier
+{
+public:
+    // constructor / desctructor
+    Barrier(int nThreads);
+
+    // typical behaviour methods
+    void arriveAndWait();
+
+private:
+    int _nThreads;             // number of threads which have to arrive before all of them are released
+    int _nWaiting;             // number of threads currently waiting in this generation
+    unsigned long _generation; // incremented whenever all threads have arrived
+    std::mutex _mutex;
+    std::condition_variable _condition;
+};
+
+// auxiliary struct holding an observer which is called by the Scheduler at fixed simulated intervals
+struct FrameCallback
+{
+    std::function<void(double)> callback; // receives the simulated time in s
+    double frameInterval;                 // simulated time between two calls in s
+    long nFrames;                         // number of calls so far
+};
+
+// auxiliary struct holding an intersection to be signalled at a later tick
+struct WakeUp
+{
+    long tick;                  // first tick in which the intersection is signalled
+    Intersection *intersection;
+
+    bool operator>(const WakeUp &other) const { return tick > other.tick; }
+};
+
+// auxiliary struct holding everything a single worker owns exclusively : the intersections of one region
+// and the vehicles driving towards them. Regions are kept on separate cache lines.
+struct alignas(64) Region
+{
+    VehicleTable vehicles;                              // motion state of the vehicles heading for an intersection of this region
+    std::vector<Intersection *> intersections;          // intersections of this region
+    std::vector<Intersection *> signalledIntersections; // intersections of this region with arrivals or departures in the current tick
+    std::vector<WakeUp> wakeUps;                        // min-heap of intersections of this region waiting for their light to turn green
+    std::vector<int> leavingSlots;                      // rows of vehicles which turned towards another region in the current tick
+    std::vector<int> enteringVehicles;                  // vehicles which turned into a street towards this region in the current tick
+    std::vector<std::vector<VehicleRow>> handoffs;      // rows handed over to every region, each emptied by its consumer in phase 2
+};
+
+// fixed-timestep engine which advances all vehicles and intersections on a bounded pool of worker threads
+class Scheduler
+{
+public:
+    // constructor / desctructor
+    Scheduler(World &world);
+    ~Scheduler();
+
+    // getters / setters
+    void setTickDuration(double tickDuration) { _tickDuration = tickDuration; }
+    double getTickDuration() { return _tickDuration; } // in s
+    void setNumWorkers(int nWorkers) { _nWorkers = nWorkers; } // fixed by the first call to simulate() or run()
+    void setIsRealTime(bool isRealTime) { _isRealTime = isRealTime; }
+    void setEndTime(double endTime) { _endTime = endTime; }
+    void addFrameCallback(double frameInterval, std::function<void(double)> callback); // called with the simulated time every frameInterval s
+    long getTickCount() { return _tickCount; }
+    double getSimulationTime() { return _tickCount * _tickDuration; } // virtual clock in s
+    void getVehicleOrder(std::vector<int> &vehicleIDs); // ids of all vehicles in the order of their rows, region by region, between two ticks only
+
+    // typical behaviour methods
+    void simulate();
+    void run(); // runs the tick loop on the calling thread with a single worker, e.g. on a thread of a BatchRunner
+    void restore(long tickCount, const std::vector<int> &vehicleIDs); // continues at a saved tick instead of building the regions in simulate() or run()
+    void stop();
+    void waitUntilFinished(); // blocks until the end time has been reached
+    void signalIntersection(Intersection *intersection); // queues an intersection for admission in the current tick, called by its owner only
+    void signalIntersectionAt(Intersection *intersection, double time); // queues an intersection for admission at a simulated time in s, called by its owner only
+
+private:
+    // typical behaviour methods
+    void createRegions();
+    void attachVehicle(Vehicle &vehicle);
+    void buildRegions();
+    void runWorker(int workerIdx);
+    void handOffLeavingVehicles(Region &region);
+    void acceptHandoffs(int regionIdx);
+
+    World &_world;                                             // all vehicles and intersections advanced by this scheduler
+    RegionPartition _partition;                                // region of every intersection, one region per worker
+    std::vector<std::unique_ptr<Region>> _regions;             // state owned by every worker
+    std::vector<std::thread> _threads;                         // worker pool, one thread per hardware core by default
+    std::unique_ptr<Barrier> _barrier;                         // separates the phases within a tick
+    double _tickDuration;                                      // simulated time per tick in s
+    bool _isRealTime;                                          // paces ticks to wall-clock time, otherwise runs as fast as possible
+    double _endTime;                                           // simulated time in s after which the tick loop ends, 0 for no limit
+    int _nWorkers;                                             // number of worker threads
+    std::atomic<bool> _isRunning;                              // cleared by stop() to end the tick loop
+    bool _isStopping;                                          // tick loop exit decision shared by all workers
+    std::atomic<long> _tickCount;                              // number of completed ticks
+    std::vector<FrameCallback> _frameCallbacks;                // observers called at fixed simulated intervals (e.g. video export, recording)
+};
+
+#endif
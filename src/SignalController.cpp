@@ -0,0 +1,82 @@
+#include <queue>
+#include <limits>
+#include <cmath>
+#include "SignalController.h"
+#include "World.h"
+
+/* Implementation of class "SignalController" */
+
+SignalController::SignalController(World &world) : _world(world)
+{
+    _cycleLength = 10.0;
+    _greenShare = 0.5;
+    _waveOriginID = -1;
+    _waveSpeed = 0.0;
+}
+
+void SignalController::setCycle(double cycleLength, double greenShare)
+{
+    _cycleLength = cycleLength;
+    _greenShare = greenShare;
+}
+
+void SignalController::setGreenWave(int originID, double speed)
+{
+    _waveOriginID = originID;
+    _waveSpeed = speed;
+}
+
+void SignalController::apply()
+{
+    // a light turns green just when a vehicle which left the origin at the start of a cycle arrives
+    std::vector<double> distances;
+    if (_waveOriginID >= 0)
+    {
+        computeDistances(distances);
+    }
+
+    auto &intersections = _world.getIntersections();
+    _plans.resize(intersections.size());
+    for (size_t id = 0; id < intersections.size(); id++)
+    {
+        SignalPlan &plan = _plans[id];
+        plan.cycleLength = _cycleLength;
+        plan.greenDuration = _greenShare * _cycleLength;
+        plan.offset = 0.0;
+        if (_waveOriginID >= 0 && std::isfinite(distances[id]))
+        {
+            plan.offset = std::fmod(distances[id] / _waveSpeed, _cycleLength);
+        }
+        intersections[id]->setSignalPlan(plan);
+    }
+}
+
+// shortest driving distance in m from the origin of the green wave to every intersection (Dijkstra)
+void SignalController::computeDistances(std::vector<double> &distances)
+{
+    const RoadGraph &roadGraph = _world.getRoadGraph();
+    distances.assign(_world.getIntersections().size(), std::numeric_limits<double>::infinity());
+    typedef std::pair<double, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+    distances[_waveOriginID] = 0.0;
+    queue.emplace(0.0, _waveOriginID);
+    while (!queue.empty())
+    {
+        QueueEntry entry = queue.top();
+        queue.pop();
+        if (entry.first > distances[entry.second])
+        {
+            continue;
+        }
+        const RoadEdge *edges = roadGraph.getEdges(entry.second);
+        for (int e = 0; e < roadGraph.getDegree(entry.second); e++)
+        {
+            double distance = entry.first + edges[e].length;
+            if (distance < distances[edges[e].otherID])
+            {
+                distances[edges[e].otherID] = distance;
+                queue.emplace(distance, edges[e].otherID);
+            }
+        }
+    }
+}
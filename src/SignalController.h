@@ -0,0 +1,38 @@
+#ifndef SIGNALCONTROLLER_H
+#define SIGNALCONTROLLER_H
+
+#include <vector>
+#include "TrafficLight.h"
+
+// forward declarations to avoid include cycle
+class World;
+
+// central controller which computes coordinated fixed-time plans for all traffic lights of a world. The plans are
+// precomputed once, afterwards every light evaluates its phase from the clock without any further coordination.
+class SignalController
+{
+public:
+    // constructor / desctructor
+    SignalController(World &world);
+
+    // getters / setters
+    void setCycle(double cycleLength, double greenShare = 0.5); // all lights share the cycle, in s
+    void setGreenWave(int originID, double speed);              // offsets by the travel time from an intersection at speed in m/s
+
+    // typical behaviour methods
+    void apply(); // assigns the plans to all lights, call once the road graph has been built
+    const std::vector<SignalPlan> &getPlans() { return _plans; }
+
+private:
+    // typical behaviour methods
+    void computeDistances(std::vector<double> &distances);
+
+    World &_world;
+    double _cycleLength;            // in s
+    double _greenShare;             // fraction of the cycle given to the first stage of every light
+    int _waveOriginID;              // intersection from which the green wave starts, -1 for synchronized lights
+    double _waveSpeed;              // in m/s
+    std::vector<SignalPlan> _plans; // plan of every intersection, indexed by id
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "TrafficObject.h"
+#include "TrafficLight.h"
+
+// appearance of a single traffic object at the time a snapshot was taken
+struct SnapshotObject
+{
+    float x, y;               // position in pixels
+    ObjectType type;          // objectIntersection or objectVehicle
+    TrafficLightPhase phase;  // phase of the traffic light (intersections only)
+    uint8_t color[3];         // fill color in BGR order
+};
+
+// consistent state of all traffic objects for the renderer : intersections first, then vehicles
+struct Snapshot
+{
+    std::vector<SnapshotObject> objects;
+    double simulationTime;    // in s, 0 in thread-per-object mode
+    long sequence;            // number of snapshots published before this one
+};
+
+// lock-free handoff of snapshots from the simulation to the renderer. A pure double buffer would
+// make the writer wait until the reader has left the front buffer, so a third slot is kept ready
+// in between : the writer fills its back buffer and swaps it with the ready slot, the reader swaps
+// its front buffer with the ready slot whenever a fresh snapshot is there. Both swaps are a single
+// atomic exchange, so neither side ever blocks or sees a buffer which is being written.
+class SnapshotBuffer
+{
+public:
+    // constructor / desctructor
+    SnapshotBuffer()
+    {
+        _back = 0;
+        _ready = 1;
+        _front = 2;
+        _nPublished = 0;
+    }
+
+    // getters / setters
+    Snapshot &getBackBuffer() { return _slots[_back]; }                          // writer only
+    bool isConsumed() { return (_ready.load(std::memory_order_acquire) & _isFresh) == 0; } // wether the reader took the last snapshot
+
+    // typical behaviour methods
+    void publish() // writer only
+    {
+        _slots[_back].sequence = _nPublished++;
+        _back = _ready.exchange(_back | _isFresh, std::memory_order_acq_rel) & _indexMask;
+    }
+
+    // returns the most recent snapshot, which stays valid and unchanged until the next call (reader only)
+    const Snapshot &acquire()
+    {
+        if (_ready.load(std::memory_order_relaxed) & _isFresh)
+        {
+            _front = _ready.exchange(_front, std::memory_order_acq_rel) & _indexMask;
+        }
+        return _slots[_front];
+    }
+
+private:
+    static const uint32_t _indexMask = 3;    // slot index within _ready
+    static const uint32_t _isFresh = 4;      // set in _ready when it holds a snapshot the reader has not taken yet
+
+    Snapshot _slots[3];
+    uint32_t _back;                          // slot being written by the simulation
+    std::atomic<uint32_t> _ready;            // slot handed over between both sides, plus the fresh flag
+    uint32_t _front;                         // slot being read by the renderer
+    long _nPublished;                        // number of snapshots published so far
+};
+
+// fixed color of every vehicle, generated from its id in the same way as cv::RNG(id) does,
+// so that vehicles keep their colors from previous versions
+inline void getVehicleColor(int vehicleID, uint8_t color[3])
+{
+    uint64_t state = vehicleID ? (uint64_t)vehicleID : 0xffffffff;
+    auto uniform = [&state](int a, int b) {
+        state = (uint64_t)(uint32_t)state * 4164903690u + (uint32_t)(state >> 32);
+        return (int)((uint32_t)state % (uint32_t)(b - a) + a);
+    };
+    int b = uniform(0, 255);
+    int g = uniform(0, 255);
+    int r = std::sqrt(std::max(0, 255*255 - g*g - b*b)); // ensure that length of color vector is always 255
+    color[0] = b;
+    color[1] = g;
+    color[2] = r;
+}
+
+#endif
@@ -8,16 +8,58 @@ Street::Street()
 {
     _type = ObjectType::objectStreet;
     _length = 1000.0; // in m
+    _interInID = -1;
+    _interOutID = -1;
+    setNumLanes(1);
 }
 
-void Street::setInIntersection(std::shared_ptr<Intersection> in)
+void Street::setNumLanes(int nLanes)
 {
-    _interIn = in;
-    in->addStreet(get_shared_this()); // add this street to list of streets connected to the intersection
+    _nLanes = nLanes;
+    _lanes.assign(2 * nLanes, Lane());
 }
 
-void Street::setOutIntersection(std::shared_ptr<Intersection> out)
+void Street::setInIntersection(Intersection &in)
 {
-    _interOut = out;
-    out->addStreet(get_shared_this()); // add this street to list of streets connected to the intersection
+    _interInID = in.getID();
+    in.addStreet(*this); // add this street to list of streets connected to the intersection
+}
+
+void Street::setOutIntersection(Intersection &out)
+{
+    _interOutID = out.getID();
+    out.addStreet(*this); // add this street to list of streets connected to the intersection
+}
+
+/* Implementation of class "Lane" */
+
+Lane::Lane()
+{
+    _vehicles.resize(4);
+    _mask = 3;
+    _head = 0;
+    _tail = 0;
+}
+
+long Lane::pushBack(int vehicleID)
+{
+    // double the capacity of a full ring and unwrap the vehicles into it, keeping their sequence numbers
+    if (getSize() > _mask)
+    {
+        std::vector<int> vehicles(2 * _vehicles.size());
+        long mask = vehicles.size() - 1;
+        for (long seq = _head; seq < _tail; seq++)
+        {
+            vehicles[seq & mask] = _vehicles[seq & _mask];
+        }
+        _vehicles.swap(vehicles);
+        _mask = mask;
+    }
+    _vehicles[_tail & _mask] = vehicleID;
+    return _tail++;
+}
+
+void Lane::popFront()
+{
+    _head++;
 }
@@ -1,12 +1,40 @@
 #ifndef STREET_H
 #define STREET_H
 
+#include <vector>
 #include "TrafficObject.h"
 
 // forward declaration to avoid include cycle
 class Intersection;
 
-class Street : public TrafficObject, public std::enable_shared_from_this<Street>
+// auxiliary class holding the vehicles of a single lane in driving order. Vehicles enter at the back, leave at the
+// front and never overtake within a lane, so the lane is a FIFO in which the leader of a vehicle is the entry just
+// before its own, found in O(1) from the sequence number the vehicle received on entry
+class Lane
+{
+public:
+    // constructor / desctructor
+    Lane();
+
+    // getters / setters
+    int getSize() { return _tail - _head; }
+    int getFront() { return _vehicles[_head & _mask]; } // id of the first vehicle, the lane must not be empty
+    int getBack() { return _vehicles[(_tail - 1) & _mask]; } // id of the last vehicle, the lane must not be empty
+    int getLeader(long seq) { return seq > _head ? _vehicles[(seq - 1) & _mask] : -1; } // id of the vehicle ahead, -1 for none
+    int getVehicle(int i) { return _vehicles[(_head + i) & _mask]; } // id of the i-th vehicle, counted from the front
+
+    // typical behaviour methods
+    long pushBack(int vehicleID); // returns the sequence number of the new last vehicle
+    void popFront();
+
+private:
+    std::vector<int> _vehicles; // ring buffer of vehicle ids, its capacity is a power of two
+    long _mask;                 // capacity - 1
+    long _head;                 // sequence number of the first vehicle
+    long _tail;                 // sequence number given to the next vehicle
+};
+
+class Street : public TrafficObject
 {
 public:
     // constructor / desctructor
@@ -14,19 +42,22 @@ public:
 
     // getters / setters
     double getLength() { return _length; }
-    void setInIntersection(std::shared_ptr<Intersection> in);
-    void setOutIntersection(std::shared_ptr<Intersection> out);
-    std::shared_ptr<Intersection> getOutIntersection() { return _interOut; }
-    std::shared_ptr<Intersection> getInIntersection() { return _interIn; }
+    void setLength(double length) { _length = length; }
+    void setInIntersection(Intersection &in);
+    void setOutIntersection(Intersection &out);
+    int getOutIntersectionID() { return _interOutID; }
+    int getInIntersectionID() { return _interInID; }
+    int getNumLanes() { return _nLanes; }
+    void setNumLanes(int nLanes);
+    Lane &getLane(int destinationID, int lane) { return _lanes[(destinationID == _interOutID ? 0 : _nLanes) + lane]; } // lanes per driving direction
 
     // typical behaviour methods
 
-    // miscellaneous
-    std::shared_ptr<Street> get_shared_this() { return shared_from_this(); }
-
 private:
-    double _length;                                    // length of this street in m
-    std::shared_ptr<Intersection> _interIn, _interOut; // intersections from which a vehicle can enter (one-way streets is always from 'in' to 'out')
+    double _length;               // length of this street in m
+    int _interInID, _interOutID;  // ids of the intersections from which a vehicle can enter (one-way streets is always from 'in' to 'out')
+    int _nLanes;                  // number of lanes in each driving direction
+    std::vector<Lane> _lanes;     // lanes towards 'out', followed by the lanes towards 'in' (used by the Scheduler)
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,58 +1,70 @@
 #include <iostream>
 #include <random>
+#include <cmath>
+#include <algorithm>
 #include "TrafficLight.h"
 
-/* Implementation of class "MessageQueue" */
-
-/* 
-template <typename T>
-T MessageQueue<T>::receive()
-{
-    // FP.5a : The method receive should use std::unique_lock<std::mutex> and _condition.wait() 
-    // to wait for and receive new messages and pull them from the queue using move semantics. 
-    // The received object should then be returned by the receive function. 
-}
-
-template <typename T>
-void MessageQueue<T>::send(T &&msg)
-{
-    // FP.4a : The method send should use the mechanisms std::lock_guard<std::mutex> 
-    // as well as _condition.notify_one() to add a new message to the queue and afterwards send a notification.
-}
-*/
-
 /* Implementation of class "TrafficLight" */
 
-/* 
 TrafficLight::TrafficLight()
 {
-    _currentPhase = TrafficLightPhase::red;
+    // unseeded objects draw from a per-process seed, one random_device per object would cost a system call each
+    static const uint64_t processSeed = std::random_device()();
+    setRandomStream(RandomStream(processSeed, getID()));
 }
 
-void TrafficLight::waitForGreen()
+// both stages last between 4 and 6 s each, cycles start anywhere, so that neighbouring lights are not coordinated
+void TrafficLight::setRandomStream(RandomStream random)
 {
-    // FP.5b : add the implementation of the method waitForGreen, in which an infinite while-loop 
-    // runs and repeatedly calls the receive function on the message queue. 
-    // Once it receives TrafficLightPhase::green, the method returns.
+    _plan.greenDuration = random.uniformReal(4.0, 6.0); // in s
+    _plan.cycleLength = _plan.greenDuration + random.uniformReal(4.0, 6.0);
+    _plan.offset = random.uniformReal(0.0, _plan.cycleLength);
 }
 
-TrafficLightPhase TrafficLight::getCurrentPhase()
+// counts from the later of the arrival and the start of the latest red up to the given time, typically that of the
+// admission, and is 0 if the vehicle has arrived after that red was over, i.e. it has never seen the light red
+double TrafficLight::getRedWait(double arrivalTime, double time, int stage)
 {
-    return _currentPhase;
+    double timeInCycle = getTimeInCycle(time);
+    double cycleStart = time - timeInCycle;
+    double redStart, redEnd;
+    if (stage == 0)
+    {
+        // red from the end of stage 0 to the end of the cycle, the latest one belongs to the previous cycle while green
+        redStart = cycleStart + _plan.greenDuration - (timeInCycle < _plan.greenDuration ? _plan.cycleLength : 0.0);
+        redEnd = redStart + _plan.cycleLength - _plan.greenDuration;
+    }
+    else
+    {
+        // red from the start of the cycle to the end of stage 0
+        redStart = cycleStart;
+        redEnd = cycleStart + _plan.greenDuration;
+    }
+    if (arrivalTime >= std::min(redEnd, time))
+    {
+        return 0.0;
+    }
+    return time - std::max(arrivalTime, redStart);
 }
 
-void TrafficLight::simulate()
+double TrafficLight::getTimeInCycle(double time)
 {
-    // FP.2b : Finally, the private method „cycleThroughPhases“ should be started in a thread when the public method „simulate“ is called. To do this, use the thread queue in the base class. 
+    double timeInCycle = std::fmod(time - _plan.offset, _plan.cycleLength);
+    return timeInCycle < 0.0 ? timeInCycle + _plan.cycleLength : timeInCycle;
 }
 
-// virtual function which is executed in a thread
-void TrafficLight::cycleThroughPhases()
+TrafficLightPhase TrafficLight::getPhase(double time, int stage)
 {
-    // FP.2a : Implement the function with an infinite loop that measures the time between two loop cycles 
-    // and toggles the current phase of the traffic light between red and green and sends an update method 
-    // to the message queue using move semantics. The cycle duration should be a random value between 4 and 6 seconds. 
-    // Also, the while-loop should use std::this_thread::sleep_for to wait 1ms between two cycles. 
+    bool isFirstStage = getTimeInCycle(time) < _plan.greenDuration;
+    return isFirstStage == (stage == 0) ? TrafficLightPhase::green : TrafficLightPhase::red;
 }
 
-*/
\ No newline at end of file
+double TrafficLight::getTimeToGreen(double time, int stage)
+{
+    double timeInCycle = getTimeInCycle(time);
+    if (stage == 0)
+    {
+        return timeInCycle < _plan.greenDuration ? 0.0 : _plan.cycleLength - timeInCycle;
+    }
+    return timeInCycle < _plan.greenDuration ? _plan.greenDuration - timeInCycle : 0.0;
+}
@@ -1,53 +1,51 @@
 #ifndef TRAFFICLIGHT_H
 #define TRAFFICLIGHT_H
 
-#include <mutex>
-#include <deque>
-#include <condition_variable>
 #include "TrafficObject.h"
+#include "RandomStream.h"
 
 // forward declarations to avoid include cycle
 class Vehicle;
 
-
-// FP.3 Define a class „MessageQueue“ which has the public methods send and receive. 
-// Send should take an rvalue reference of type TrafficLightPhase whereas receive should return this type. 
-// Also, the class should define an std::dequeue called _queue, which stores objects of type TrafficLightPhase. 
-// Also, there should be an std::condition_variable as well as an std::mutex as private members. 
-
-template <class T>
-class MessageQueue
+enum TrafficLightPhase
 {
-public:
-
-private:
-    
+    red,
+    green,
 };
 
-// FP.1 : Define a class „TrafficLight“ which is a child class of TrafficObject. 
-// The class shall have the public methods „void waitForGreen()“ and „void simulate()“ 
-// as well as „TrafficLightPhase getCurrentPhase()“, where TrafficLightPhase is an enum that 
-// can be either „red“ or „green“. Also, add the private method „void cycleThroughPhases()“. 
-// Furthermore, there shall be the private member _currentPhase which can take „red“ or „green“ as its value. 
+// auxiliary struct holding the fixed-time signal plan of a single traffic light : every cycle starts at
+// offset + k * cycleLength with greenDuration s of green for the approaches of stage 0, followed by green
+// for the approaches of stage 1 for the rest of the cycle
+struct SignalPlan
+{
+    double cycleLength;   // in s
+    double greenDuration; // duration of stage 0 in s
+    double offset;        // start of a cycle in s, shifts the light against the others (e.g. for green waves)
+};
 
-class TrafficLight
+// traffic light evaluated lazily from a clock : its phase is a pure function of the time and its plan,
+// so it needs no thread and no timer, and any number of lights cost nothing while nobody looks at them.
+// The light alternates between two stages, each of which gives green to its own set of approaches.
+class TrafficLight : public TrafficObject
 {
 public:
     // constructor / desctructor
+    TrafficLight();
 
     // getters / setters
-
-    // typical behaviour methods
+    static const int nStages = 2;
+    TrafficLightPhase getPhase(double time, int stage = 0); // phase of the approaches of a stage at the given time in s
+    double getTimeToGreen(double time, int stage = 0);      // time in s until the stage turns green, 0 while it is green
+    double getRedWait(double arrivalTime, double time, int stage = 0); // time in s a vehicle has waited since the latest red of the stage began
+    const SignalPlan &getPlan() { return _plan; }
+    void setPlan(const SignalPlan &plan) { _plan = plan; } // set by the SignalController
+    void setRandomStream(RandomStream random); // draws an uncoordinated plan from the stream
 
 private:
-    // typical behaviour methods
-
-    // FP.4b : create a private member of type MessageQueue for messages of type TrafficLightPhase 
-    // and use it within the infinite loop to push each new TrafficLightPhase into it by calling 
-    // send in conjunction with move semantics.
+    // getters / setters
+    double getTimeInCycle(double time);
 
-    std::condition_variable _condition;
-    std::mutex _mutex;
+    SignalPlan _plan; // timing of this light
 };
 
-#endif
\ No newline at end of file
+#endif
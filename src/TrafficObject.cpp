@@ -4,26 +4,41 @@
 #include "TrafficObject.h"
 
 // init static variable
-int TrafficObject::_idCnt = 0;
-
-std::mutex TrafficObject::_mtx;
+std::atomic<int> TrafficObject::_idCnt(0);
 
 void TrafficObject::setPosition(double x, double y)
 {
-    _posX = x;
-    _posY = y;
+    // readers on other threads retry while the version is odd or has changed, so they never see x and y of different updates
+    uint32_t version = _posVersion.load(std::memory_order_relaxed);
+    _posVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _posX.store(x, std::memory_order_relaxed);
+    _posY.store(y, std::memory_order_relaxed);
+    _posVersion.store(version + 2, std::memory_order_release);
 }
 
 void TrafficObject::getPosition(double &x, double &y)
 {
-    x = _posX;
-    y = _posY;
+    while (true)
+    {
+        uint32_t version = _posVersion.load(std::memory_order_acquire);
+        x = _posX.load(std::memory_order_relaxed);
+        y = _posY.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((version & 1) == 0 && _posVersion.load(std::memory_order_relaxed) == version)
+        {
+            return;
+        }
+    }
 }
 
 TrafficObject::TrafficObject()
 {
     _type = ObjectType::noObject;
     _id = _idCnt++;
+    _posX = 0.0;
+    _posY = 0.0;
+    _posVersion = 0;
 }
 
 TrafficObject::~TrafficObject()
@@ -4,6 +4,9 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 enum ObjectType
 {
@@ -22,8 +25,9 @@ public:
 
     // getter and setter
     int getID() { return _id; }
+    void setID(int id) { _id = id; } // used by World to assign ids which are dense per object type
     void setPosition(double x, double y);
-    void getPosition(double &x, double &y);
+    virtual void getPosition(double &x, double &y);
     ObjectType getType() { return _type; }
 
     // typical behaviour methods
@@ -32,12 +36,12 @@ public:
 protected:
     ObjectType _type;                 // identifies the class type
     int _id;                          // every traffic object has its own unique id
-    double _posX, _posY;              // vehicle position in pixels
+    std::atomic<double> _posX, _posY; // vehicle position in pixels, written by the owning thread only
+    std::atomic<uint32_t> _posVersion; // sequence lock : odd while a position update is in progress
     std::vector<std::thread> threads; // holds all threads that have been launched within this object
-    static std::mutex _mtx;           // mutex shared by all traffic objects for protecting cout 
 
 private:
-    static int _idCnt; // global variable for counting object ids
+    static std::atomic<int> _idCnt; // global variable for counting object ids, worlds may be built concurrently
 };
 
 #endif
\ No newline at end of file
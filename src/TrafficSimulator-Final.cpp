@@ -1,159 +1,646 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
 
-#include "Vehicle.h"
-#include "Street.h"
-#include "Intersection.h"
+#include "World.h"
+#include "CityMap.h"
+#include "BatchRunner.h"
+#include "SignalController.h"
+#include "Logger.h"
+#include "MetricsExporter.h"
+#include "Scheduler.h"
 #include "Graphics.h"
+#include "FrameExporter.h"
+#include "TrajectoryRecorder.h"
+#include "TrajectoryReader.h"
+#include "Checkpoint.h"
 
 
-// Paris
-void createTrafficObjects_Paris(std::vector<std::shared_ptr<Street>> &streets, std::vector<std::shared_ptr<Intersection>> &intersections, std::vector<std::shared_ptr<Vehicle>> &vehicles, std::string &filename, int nVehicles)
+// plays back a trajectory log written with --record instead of simulating
+int replayTrajectory(const std::string &logFilename, const std::string &backgroundImg, double fromTime, double endTime,
+                     bool isHeadless, const std::string &exportFilename, double fps, ExportPolicy exportPolicy)
 {
-    // assign filename of corresponding city map
-    // Note: You can use the webp format instead of jpeg
-    // According to Google - WebP lossless images are 26% smaller in size compared to PNGs. 
-    // WebP lossy images are 25-34% smaller than comparable JPEG images at equivalent SSIM quality index. 
-    filename = "../data/paris.jpg";
-
-    // init traffic objects
-    int nIntersections = 9;
-    for (size_t ni = 0; ni < nIntersections; ni++)
+    // a corrupted log is only detected while it is decoded, so every part of the replay may throw
+    std::unique_ptr<TrajectoryReader> reader;
+    double tickDuration;
+    long firstTick, lastTick;
+    try
     {
-        intersections.push_back(std::make_shared<Intersection>());
+        reader.reset(new TrajectoryReader(logFilename));
+        tickDuration = reader->getTickDuration();
+        firstTick = std::max(reader->getFirstTick(), std::lround(fromTime / tickDuration));
+        lastTick = std::min(reader->getLastTick(), std::lround(endTime / tickDuration));
+        reader->seek(firstTick);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
 
-    // position intersections in pixel coordinates (counter-clockwise)
-    intersections.at(0)->setPosition(385, 270);
-    intersections.at(1)->setPosition(1240, 80);
-    intersections.at(2)->setPosition(1625, 75);
-    intersections.at(3)->setPosition(2110, 75);
-    intersections.at(4)->setPosition(2840, 175);
-    intersections.at(5)->setPosition(3070, 680);
-    intersections.at(6)->setPosition(2800, 1400);
-    intersections.at(7)->setPosition(400, 1100);
-    intersections.at(8)->setPosition(1700, 900); // central plaza
-
-    // create streets and connect traffic objects
-    int nStreets = 8;
-    for (size_t ns = 0; ns < nStreets; ns++)
+    if (!exportFilename.empty())
     {
-        streets.push_back(std::make_shared<Street>());
-        streets.at(ns)->setInIntersection(intersections.at(ns));
-        streets.at(ns)->setOutIntersection(intersections.at(8));
+        // render frames at fixed simulated intervals, exactly as a live export would
+        std::unique_ptr<FrameExporter> exporter;
+        try
+        {
+            exporter.reset(new FrameExporter(backgroundImg, exportFilename, fps, exportPolicy));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        int status = 0;
+        try
+        {
+            for (double time = firstTick * tickDuration; reader->advanceTo(std::lround(time / tickDuration)) && reader->getTick() <= lastTick; time += 1.0 / fps)
+            {
+                reader->writeSnapshot(exporter->getNextFrame());
+                exporter->queueNextFrame();
+            }
+        }
+        catch (const std::exception &e)
+        {
+            // write the frames decoded so far
+            std::cerr << e.what() << std::endl;
+            status = 1;
+        }
+        exporter->finish();
+        std::cout << "Exported " << exporter->getNumWritten() << " frames to " << exportFilename << " ("
+                  << exporter->getNumDropped() << " dropped)" << std::endl;
+        return status;
     }
 
-    // add vehicles to streets
-    for (size_t nv = 0; nv < nVehicles; nv++)
+    if (isHeadless)
     {
-        vehicles.push_back(std::make_shared<Vehicle>());
-        vehicles.at(nv)->setCurrentStreet(streets.at(nv));
-        vehicles.at(nv)->setCurrentDestination(intersections.at(8));
+        // summarize the log once per simulated second
+        long ticksPerSecond = std::max(1L, std::lround(1.0 / tickDuration));
+        std::cout << "time,waiting,crossing,mean_speed" << std::endl;
+        for (long tick = firstTick; tick <= lastTick; tick += ticksPerSecond)
+        {
+            try
+            {
+                reader->advanceTo(tick);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            int nWaiting = 0, nCrossing = 0;
+            double speedSum = 0.0;
+            for (int id = 0; id < reader->getNumVehicles(); id++)
+            {
+                const VehicleRecord &record = reader->getVehicle(id);
+                nWaiting += record.state == VehicleState::stateWaiting;
+                nCrossing += record.state == VehicleState::stateCrossing;
+                speedSum += VehicleRecord::dequantize(record.speed);
+            }
+            std::cout << tick * tickDuration << "," << nWaiting << "," << nCrossing << ","
+                      << speedSum / std::max(1, reader->getNumVehicles()) << std::endl;
+        }
+        return 0;
     }
+
+    // advance the log in line with wall-clock time and hand its state to the renderer
+    SnapshotBuffer snapshots;
+    std::thread player([&reader, &snapshots, firstTick, lastTick, tickDuration]() {
+        auto start = std::chrono::steady_clock::now();
+        for (long tick = firstTick; tick <= lastTick;)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            tick = firstTick + std::lround(elapsed / tickDuration);
+            try
+            {
+                reader->advanceTo(std::min(tick, lastTick));
+            }
+            catch (const std::exception &e)
+            {
+                // keep showing the last state which could be decoded
+                std::cerr << e.what() << std::endl;
+                return;
+            }
+            if (snapshots.isConsumed())
+            {
+                Snapshot &snapshot = snapshots.getBackBuffer();
+                reader->writeSnapshot(snapshot);
+                snapshots.publish();
+            }
+        }
+    });
+
+    Graphics *graphics = new Graphics();
+    graphics->setBgFilename(backgroundImg);
+    graphics->setSnapshotBuffer(snapshots);
+    graphics->simulate();
+    player.join();
+    return 0;
 }
 
-// NYC
-void createTrafficObjects_NYC(std::vector<std::shared_ptr<Street>> &streets, std::vector<std::shared_ptr<Intersection>> &intersections, std::vector<std::shared_ptr<Vehicle>> &vehicles, std::string &filename, int nVehicles)
+// parses a complete argument as a finite number, throws std::invalid_argument on trailing characters, NaN or infinity
+double parseNumber(const std::string &text)
 {
-    // assign filename of corresponding city map
-    // Note: You can use the webp format instead of jpeg
-    filename = "../data/nyc.jpg";
+    size_t length;
+    double value = std::stod(text, &length);
+    if (length != text.size() || !std::isfinite(value))
+    {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
 
-    // init traffic objects
-    int nIntersections = 6;
-    for (size_t ni = 0; ni < nIntersections; ni++)
+// parses a complete argument as an integer, throws std::invalid_argument on trailing characters
+long parseInteger(const std::string &text)
+{
+    size_t length;
+    long value = std::stol(text, &length);
+    if (length != text.size())
     {
-        intersections.push_back(std::make_shared<Intersection>());
+        throw std::invalid_argument(text);
     }
+    return value;
+}
 
-    // position intersections in pixel coordinates
-    intersections.at(0)->setPosition(1430, 625);
-    intersections.at(1)->setPosition(2575, 1260);
-    intersections.at(2)->setPosition(2200, 1950);
-    intersections.at(3)->setPosition(1000, 1350);
-    intersections.at(4)->setPosition(400, 1000);
-    intersections.at(5)->setPosition(750, 250);
+// parses a complete argument as a seed, throws std::invalid_argument on trailing characters or a minus sign, which
+// std::stoull would silently wrap around
+uint64_t parseSeed(const std::string &text)
+{
+    size_t length;
+    uint64_t value = std::stoull(text, &length);
+    if (length != text.size() || text.find('-') != std::string::npos)
+    {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
 
-    // create streets and connect traffic objects
-    int nStreets = 7;
-    for (size_t ns = 0; ns < nStreets; ns++)
+// runs every combination of a sweep file headless on a shared pool of threads and writes one line per run
+int runBatch(const std::string &sweepFilename, int nThreads, const std::string &outFilename)
+{
+    BatchRunner runner;
+    if (nThreads > 0)
+    {
+        runner.setNumThreads(nThreads);
+    }
+    std::ofstream out;
+    try
     {
-        streets.push_back(std::make_shared<Street>());
+        runner.loadSweep(sweepFilename);
+        out.open(outFilename);
+        if (!out)
+        {
+            throw std::runtime_error("Cannot open " + outFilename);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
 
-    streets.at(0)->setInIntersection(intersections.at(0));
-    streets.at(0)->setOutIntersection(intersections.at(1));
+    auto start = std::chrono::steady_clock::now();
+    runner.run();
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    runner.writeCsv(out);
+    std::cout << "Ran " << runner.getRuns().size() << " simulations in " << wallTime << " s wall time, summaries written to "
+              << outFilename << std::endl;
+    if (runner.getNumFailedRuns() > 0)
+    {
+        std::cerr << runner.getNumFailedRuns() << " runs failed, see the error column of " << outFilename << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
-    streets.at(1)->setInIntersection(intersections.at(1));
-    streets.at(1)->setOutIntersection(intersections.at(2));
+/* Main function */
+int main(int argc, char *argv[])
+{
+    // parse command line options
+    // --engine      : advance all objects on a fixed-timestep worker pool instead of one thread per object
+    // --workers <n> : number of worker threads used by the engine (default: number of hardware cores)
+    // --tick <ms>   : duration of a single engine tick in ms (default: 1)
+    // --headless    : run the engine as fast as possible without a window and report the speed-up
+    // --end <s>     : simulated time after which a headless run ends (default: 3600)
+    // --seed <n>    : seed of all random streams, identical seeds give identical engine runs (default: random)
+    // --export <f>  : render a headless run into a video file (.avi, .mp4) or an image sequence (e.g. frame_%05d.png)
+    // --fps <n>     : frames per simulated second of the export (default: 25)
+    // --drop-frames : drop frames while the encoder lags behind instead of slowing down the simulation
+    // --record <f>  : write the state of every engine tick into a binary trajectory log
+    // --replay <f>  : play back a trajectory log instead of simulating, in a window, as --export or as --headless statistics
+    // --from <s>    : simulated time at which a replay starts (default: 0)
+    // --map <f>     : city map to simulate, in text or binary form (default: ../data/paris.map)
+    // --save-map <f>: write the city map in binary form, which loads much faster, and exit
+    // --log-every <n>: log only every n-th occurrence of frequent events such as entry grants (default: 1)
+    // --metrics <f> : write counters and latency histograms in the Prometheus text format into a file, periodically and at the end
+    // --metrics-interval <s>: wall-clock time between two metrics dumps (default: 5)
+    // --signal-cycle <s>: coordinate all traffic lights on a common cycle, half of it green (default: uncoordinated random cycles)
+    // --green-wave <m/s>: offset the coordinated lights by the travel time from intersection 0 at the given speed
+    // --batch <f>   : run every combination of a sweep file headless, concurrently on a pool of --workers threads, and exit
+    // --out <f>     : CSV file receiving one summary line per run of a batch (default: batch.csv)
+    // --checkpoint <f>: save the complete state of the engine into a file periodically and at the end of a headless run
+    // --checkpoint-interval <s>: simulated time between two checkpoints (default: 300)
+    // --restore <f> : continue an engine run from a checkpoint of the same map and tick instead of starting anew, with any number of workers
+    bool useEngine = false;
+    bool hasSeed = false;
+    uint64_t seed = 0;
+    bool isHeadless = false;
+    int nWorkers = 0;
+    double tickDuration = 1.0;
+    double endTime = 3600.0;
+    std::string exportFilename;
+    double fps = 25.0;
+    ExportPolicy exportPolicy = ExportPolicy::blockSimulation;
+    std::string recordFilename;
+    std::string replayFilename;
+    double fromTime = 0.0;
+    std::string mapFilename = "../data/paris.map";
+    std::string binaryMapFilename;
+    long logSamplingPeriod = 1;
+    std::string metricsFilename;
+    double metricsInterval = 5.0;
+    double signalCycle = 0.0;
+    double greenWaveSpeed = 0.0;
+    std::string batchFilename;
+    std::string outFilename = "batch.csv";
+    std::string checkpointFilename;
+    double checkpointInterval = 300.0;
+    std::string restoreFilename;
+    bool isValid = true;
+    try
+    {
+        for (int i = 1; isValid && i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--engine")
+            {
+                useEngine = true;
+            }
+            else if (arg == "--workers" && i + 1 < argc)
+            {
+                nWorkers = parseInteger(argv[++i]);
+                isValid = nWorkers > 0;
+            }
+            else if (arg == "--tick" && i + 1 < argc)
+            {
+                tickDuration = parseNumber(argv[++i]);
+                isValid = tickDuration > 0.0;
+            }
+            else if (arg == "--headless")
+            {
+                useEngine = true;
+                isHeadless = true;
+            }
+            else if (arg == "--end" && i + 1 < argc)
+            {
+                endTime = parseNumber(argv[++i]);
+                isValid = endTime > 0.0;
+            }
+            else if (arg == "--seed" && i + 1 < argc)
+            {
+                hasSeed = true;
+                seed = parseSeed(argv[++i]);
+            }
+            else if (arg == "--export" && i + 1 < argc)
+            {
+                useEngine = true;
+                isHeadless = true;
+                exportFilename = argv[++i];
+            }
+            else if (arg == "--fps" && i + 1 < argc)
+            {
+                fps = parseNumber(argv[++i]);
+                isValid = fps > 0.0;
+            }
+            else if (arg == "--drop-frames")
+            {
+                exportPolicy = ExportPolicy::dropFrames;
+            }
+            else if (arg == "--record" && i + 1 < argc)
+            {
+                useEngine = true;
+                recordFilename = argv[++i];
+            }
+            else if (arg == "--replay" && i + 1 < argc)
+            {
+                replayFilename = argv[++i];
+            }
+            else if (arg == "--from" && i + 1 < argc)
+            {
+                fromTime = parseNumber(argv[++i]);
+                isValid = fromTime >= 0.0;
+            }
+            else if (arg == "--map" && i + 1 < argc)
+            {
+                mapFilename = argv[++i];
+            }
+            else if (arg == "--save-map" && i + 1 < argc)
+            {
+                binaryMapFilename = argv[++i];
+            }
+            else if (arg == "--log-every" && i + 1 < argc)
+            {
+                logSamplingPeriod = std::max(1L, parseInteger(argv[++i]));
+            }
+            else if (arg == "--metrics" && i + 1 < argc)
+            {
+                metricsFilename = argv[++i];
+            }
+            else if (arg == "--metrics-interval" && i + 1 < argc)
+            {
+                metricsInterval = parseNumber(argv[++i]);
+                isValid = metricsInterval > 0.0;
+            }
+            else if (arg == "--signal-cycle" && i + 1 < argc)
+            {
+                signalCycle = parseNumber(argv[++i]);
+                isValid = signalCycle >= 0.0;
+            }
+            else if (arg == "--green-wave" && i + 1 < argc)
+            {
+                greenWaveSpeed = parseNumber(argv[++i]);
+                isValid = greenWaveSpeed >= 0.0;
+            }
+            else if (arg == "--batch" && i + 1 < argc)
+            {
+                batchFilename = argv[++i];
+            }
+            else if (arg == "--out" && i + 1 < argc)
+            {
+                outFilename = argv[++i];
+            }
+            else if (arg == "--checkpoint" && i + 1 < argc)
+            {
+                useEngine = true;
+                checkpointFilename = argv[++i];
+            }
+            else if (arg == "--checkpoint-interval" && i + 1 < argc)
+            {
+                checkpointInterval = parseNumber(argv[++i]);
+                isValid = checkpointInterval > 0.0;
+            }
+            else if (arg == "--restore" && i + 1 < argc)
+            {
+                useEngine = true;
+                restoreFilename = argv[++i];
+            }
+            else
+            {
+                isValid = false;
+            }
+        }
+    }
+    catch (const std::exception &)
+    {
+        // parseNumber, parseInteger and parseSeed throw on malformed numbers
+        isValid = false;
+    }
+    if (!isValid)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--engine] [--workers <n>] [--tick <ms>] [--headless [--end <s>]] [--seed <n>]"
+                  << " [--export <file> [--fps <n>] [--drop-frames]] [--record <log> | --replay <log> [--from <s>]]"
+                  << " [--map <file>] [--save-map <file>] [--log-every <n>] [--metrics <file> [--metrics-interval <s>]]"
+                  << " [--signal-cycle <s>] [--green-wave <m/s>] [--batch <sweep> [--out <csv>]]"
+                  << " [--checkpoint <file> [--checkpoint-interval <s>]] [--restore <file>]" << std::endl;
+        return 1;
+    }
 
-    streets.at(2)->setInIntersection(intersections.at(2));
-    streets.at(2)->setOutIntersection(intersections.at(3));
+    Logger::getInstance().setSamplingPeriod(logSamplingPeriod);
+    if (!batchFilename.empty())
+    {
+        return runBatch(batchFilename, nWorkers, outFilename);
+    }
 
-    streets.at(3)->setInIntersection(intersections.at(3));
-    streets.at(3)->setOutIntersection(intersections.at(4));
+    /* PART 1 : Set up traffic objects */
 
-    streets.at(4)->setInIntersection(intersections.at(4));
-    streets.at(4)->setOutIntersection(intersections.at(5));
+    // load the city map and create and connect intersections, streets and vehicles in bulk
+    std::unique_ptr<CityMap> cityMap;
+    try
+    {
+        cityMap.reset(new CityMap(mapFilename));
+        if (!binaryMapFilename.empty())
+        {
+            cityMap->saveBinary(binaryMapFilename);
+            std::cout << "Saved " << cityMap->getNumIntersections() << " intersections and " << cityMap->getNumStreets()
+                      << " streets to " << binaryMapFilename << std::endl;
+            return 0;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::string backgroundImg = cityMap->getBackgroundFilename();
+    if (!replayFilename.empty())
+    {
+        return replayTrajectory(replayFilename, backgroundImg, fromTime, endTime, isHeadless, exportFilename, fps, exportPolicy);
+    }
 
-    streets.at(5)->setInIntersection(intersections.at(5));
-    streets.at(5)->setOutIntersection(intersections.at(0));
+    World world;
+    if (hasSeed)
+    {
+        world.setSeed(seed);
+    }
+    cityMap->build(world);
+    if (signalCycle > 0.0 || greenWaveSpeed > 0.0)
+    {
+        // replace the random plans of all lights by coordinated ones
+        SignalController signalController(world);
+        if (signalCycle > 0.0)
+        {
+            signalController.setCycle(signalCycle);
+        }
+        if (greenWaveSpeed > 0.0)
+        {
+            signalController.setGreenWave(0, greenWaveSpeed);
+        }
+        signalController.apply();
+    }
+    std::vector<std::shared_ptr<Intersection>> &intersections = world.getIntersections();
+    std::vector<std::shared_ptr<Vehicle>> &vehicles = world.getVehicles();
 
-    streets.at(6)->setInIntersection(intersections.at(0));
-    streets.at(6)->setOutIntersection(intersections.at(3));
+    /* PART 2 : simulate traffic objects */
 
-    // add vehicles to streets
-    for (size_t nv = 0; nv < nVehicles; nv++)
+    std::unique_ptr<Scheduler> scheduler;
+    std::unique_ptr<FrameExporter> exporter;
+    std::unique_ptr<TrajectoryRecorder> recorder;
+    std::unique_ptr<MetricsExporter> metricsExporter;
+    std::unique_ptr<Checkpoint> checkpoint;
+    if (!metricsFilename.empty())
     {
-        vehicles.push_back(std::make_shared<Vehicle>());
-        vehicles.at(nv)->setCurrentStreet(streets.at(nv));
-        vehicles.at(nv)->setCurrentDestination(intersections.at(nv));
+        // dump from a thread of its own, the simulation keeps running
+        metricsExporter.reset(new MetricsExporter(world, metricsFilename, metricsInterval));
+        metricsExporter->start();
     }
-}
+    if (useEngine)
+    {
+        // advance all vehicles and intersections in fixed ticks on a bounded worker pool
+        scheduler.reset(new Scheduler(world));
+        scheduler->setTickDuration(tickDuration / 1000.0);
+        if (nWorkers > 0)
+        {
+            scheduler->setNumWorkers(nWorkers);
+        }
+        if (isHeadless)
+        {
+            // decouple the virtual clock from wall-clock time and stop at the end time
+            scheduler->setIsRealTime(false);
+            scheduler->setEndTime(endTime);
+        }
+        if (!exportFilename.empty())
+        {
+            // render and encode frames on a pipeline stage of their own, fed at fixed simulated intervals
+            try
+            {
+                exporter.reset(new FrameExporter(backgroundImg, exportFilename, fps, exportPolicy));
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            FrameExporter *frameExporter = exporter.get();
+            scheduler->addFrameCallback(1.0 / fps, [frameExporter, &world](double simulationTime) {
+                frameExporter->addFrame(world, simulationTime);
+            });
+        }
+        if (!recordFilename.empty())
+        {
+            // append the state after every tick, while all workers wait at the barrier
+            try
+            {
+                recorder.reset(new TrajectoryRecorder(world, recordFilename, tickDuration / 1000.0));
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            TrajectoryRecorder *trajectoryRecorder = recorder.get();
+            Scheduler *engine = scheduler.get();
+            scheduler->addFrameCallback(tickDuration / 1000.0, [trajectoryRecorder, engine](double) {
+                trajectoryRecorder->recordTick(engine->getTickCount());
+            });
+        }
+        if (!checkpointFilename.empty())
+        {
+            // copy the state while all workers wait at the barrier and write it in the background,
+            // the frame at the start of a run holds nothing worth saving
+            checkpoint.reset(new Checkpoint(world, *scheduler, checkpointFilename));
+            Checkpoint *engineCheckpoint = checkpoint.get();
+            scheduler->addFrameCallback(checkpointInterval, [engineCheckpoint, checkpointInterval](double simulationTime) {
+                if (simulationTime >= checkpointInterval)
+                {
+                    engineCheckpoint->save();
+                }
+            });
+        }
+        if (!restoreFilename.empty())
+        {
+            // the map has been built as usual, the checkpoint replaces the state of all of its objects
+            try
+            {
+                Checkpoint(world, *scheduler, restoreFilename).restore();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            std::cout << "Restored " << restoreFilename << " at " << scheduler->getSimulationTime() << " s" << std::endl;
+        }
+        scheduler->simulate();
+    }
+    else
+    {
+        // simulate intersection
+        std::for_each(intersections.begin(), intersections.end(), [](std::shared_ptr<Intersection> &i) {
+            i->simulate();
+        });
 
-/* Main function */
-int main()
-{
-    /* PART 1 : Set up traffic objects */
+        // simulate vehicles
+        std::for_each(vehicles.begin(), vehicles.end(), [](std::shared_ptr<Vehicle> &v) {
+            v->simulate();
+        });
+    }
 
-    // create and connect intersections and streets
-    std::vector<std::shared_ptr<Street>> streets;
-    std::vector<std::shared_ptr<Intersection>> intersections;
-    std::vector<std::shared_ptr<Vehicle>> vehicles;
-    std::string backgroundImg;
-    int nVehicles = 6;
-    createTrafficObjects_Paris(streets, intersections, vehicles, backgroundImg, nVehicles);
+    if (isHeadless)
+    {
+        // wait for the end of the simulation and report the speed-up over real time
+        auto start = std::chrono::steady_clock::now();
+        scheduler->waitUntilFinished();
+        double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double simulationTime = scheduler->getSimulationTime();
 
-    /* PART 2 : simulate traffic objects */
+        // fingerprint the final vehicle positions, so that runs can be compared bit for bit
+        uint64_t checksum = world.getChecksum();
 
-    // simulate intersection
-    std::for_each(intersections.begin(), intersections.end(), [](std::shared_ptr<Intersection> &i) {
-        i->simulate();
-    });
+        std::cout << "Simulated " << simulationTime << " s in " << wallTime << " s wall time ("
+                  << simulationTime / wallTime << " simulated seconds per wall second, "
+                  << scheduler->getTickCount() << " ticks, " << vehicles.size() << " vehicles)" << std::endl;
+        std::cout << "Seed " << world.getSeed() << ", trajectory checksum " << std::hex << checksum << std::dec << std::endl;
 
-    // simulate vehicles
-    std::for_each(vehicles.begin(), vehicles.end(), [](std::shared_ptr<Vehicle> &v) {
-        v->simulate();
-    });
+        if (exporter)
+        {
+            // wait for the encoder to write all queued frames
+            exporter->finish();
+            std::cout << "Exported " << exporter->getNumWritten() << " frames to " << exportFilename << " ("
+                      << exporter->getNumDropped() << " dropped)" << std::endl;
+        }
+        if (recorder)
+        {
+            recorder->close();
+            std::cout << "Recorded " << recorder->getNumBytesWritten() << " bytes to " << recordFilename << " ("
+                      << recorder->getNumDroppedChunks() << " chunks dropped)" << std::endl;
+        }
+        if (checkpoint)
+        {
+            // the final state allows to continue the run later on
+            checkpoint->finish();
+            if (checkpoint->getTick() != scheduler->getTickCount())
+            {
+                checkpoint->save();
+                checkpoint->finish();
+            }
+            std::cout << "Saved checkpoint of " << checkpoint->getData().size() << " bytes to " << checkpointFilename << std::endl;
+        }
+        if (metricsExporter)
+        {
+            metricsExporter->finish();
+            std::cout << "Wrote metrics to " << metricsFilename << std::endl;
+        }
+        return 0;
+    }
 
     /* PART 3 : Launch visualization */
 
-    // add all objects into common vector
-    std::vector<std::shared_ptr<TrafficObject>> trafficObjects;
-    std::for_each(intersections.begin(), intersections.end(), [&trafficObjects](std::shared_ptr<Intersection> &intersection) {
-        std::shared_ptr<TrafficObject> trafficObject = std::dynamic_pointer_cast<TrafficObject>(intersection);
-        trafficObjects.push_back(trafficObject);
-    });
-
-    std::for_each(vehicles.begin(), vehicles.end(), [&trafficObjects](std::shared_ptr<Vehicle> &vehicles) {
-        std::shared_ptr<TrafficObject> trafficObject = std::dynamic_pointer_cast<TrafficObject>(vehicles);
-        trafficObjects.push_back(trafficObject);
-    });
+    // in thread-per-object mode, publish snapshots from a thread of their own (the engine publishes them at the end of a tick)
+    std::thread publisher;
+    if (!useEngine)
+    {
+        publisher = std::thread([&world]() {
+            while (true)
+            {
+                world.publishSnapshot();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
 
-    // draw all objects in vector
+    // draw all objects of the latest snapshot
     Graphics *graphics = new Graphics();
     graphics->setBgFilename(backgroundImg);
-    graphics->setTrafficObjects(trafficObjects);
+    graphics->setSnapshotBuffer(world.getSnapshotBuffer());
     graphics->simulate();
+    publisher.join();
 }
@@ -0,0 +1,185 @@
+#ifndef TRAJECTORYFORMAT_H
+#define TRAJECTORYFORMAT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+// binary trajectory log, written by TrajectoryRecorder and read by TrajectoryReader.
+//
+//   header : "TRJ1", seed (u64), tick duration (f64),
+//            #intersections (u32) + x, y (f64) each, #streets (u32) + in id, out id (i32), length (f64) each, #vehicles (u32)
+//   chunk  : "CHNK", payload size (u32), first tick (i64), payload
+//            payload = key frame with the full state, then delta records of the following ticks
+//   index  : "INDX", #chunks (u32) + first tick (i64), file offset (u64) of every chunk
+//   footer : index offset (u64), last tick (i64), "TRJE"
+//
+// A key frame holds every vehicle as street (varint), destination (varint), position (zigzag varint, mm),
+// speed (zigzag varint, mm/s) and state (u8), followed by the phase (u8) of every traffic light. A delta
+// record holds the ticks since the previous record (varint), the changed vehicles as id difference
+// (varint), a field mask (u8) and the changed fields, and the changed traffic lights as id difference
+// (varint) and phase (u8). Ticks without changes take no space. Positions and speeds are quantized
+// before taking differences, so replaying the deltas reproduces the quantized values exactly.
+// Chunks are self-contained, so a log which was not closed properly is still readable chunk by chunk.
+
+// state of a vehicle's intersection handshake
+enum VehicleState
+{
+    stateDriving,  // on its way to the next intersection
+    stateWaiting,  // waiting in front of the intersection for entry
+    stateCrossing, // granted entry and crossing the intersection
+};
+
+// recorded state of a single vehicle, positions and speeds quantized to mm and mm/s
+struct VehicleRecord
+{
+    int32_t streetID;
+    int32_t destinationID;
+    int64_t posStreet;     // position along the street in mm
+    int64_t speed;         // speed in mm/s
+    uint8_t state;         // VehicleState
+
+    static int64_t quantize(double value) { return std::llround(value * 1000.0); }
+    static double dequantize(int64_t value) { return value / 1000.0; }
+};
+
+// bits of the field mask of a vehicle in a delta record
+const uint8_t fieldStreet = 1;   // street and destination follow as varints
+const uint8_t fieldPosition = 2; // position difference follows as zigzag varint
+const uint8_t fieldSpeed = 4;    // speed difference follows as zigzag varint
+const uint8_t fieldState = 8;    // state follows as u8
+
+const char trajectoryMagic[4] = {'T', 'R', 'J', '1'};
+const char chunkMagic[4] = {'C', 'H', 'N', 'K'};
+const char indexMagic[4] = {'I', 'N', 'D', 'X'};
+const char footerMagic[4] = {'T', 'R', 'J', 'E'};
+const size_t chunkHeaderSize = 16;
+const size_t footerSize = 20;
+
+// appends fixed-size values and variable-length integers to a byte buffer
+class ByteWriter
+{
+public:
+    // constructor / desctructor
+    ByteWriter(std::vector<uint8_t> &buffer) : _buffer(buffer) {}
+
+    // typical behaviour methods
+    template <class T>
+    void put(T value)
+    {
+        size_t size = _buffer.size();
+        _buffer.resize(size + sizeof(T));
+        std::memcpy(_buffer.data() + size, &value, sizeof(T));
+    }
+
+    void putBytes(const char *bytes, size_t n) { _buffer.insert(_buffer.end(), bytes, bytes + n); }
+
+    void putVarint(uint64_t value)
+    {
+        // 7 bits per byte, the high bit marks that more bytes follow
+        while (value >= 0x80)
+        {
+            _buffer.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        _buffer.push_back((uint8_t)value);
+    }
+
+    void putZigzag(int64_t value) { putVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63)); } // small magnitudes give short varints
+
+private:
+    std::vector<uint8_t> &_buffer;
+};
+
+// reads values written by ByteWriter from a memory range. Every read is checked against the end of the range
+// and throws std::runtime_error instead of reading beyond it, so that truncated or corrupted files are detected
+class ByteReader
+{
+public:
+    // constructor / desctructor
+    ByteReader(const uint8_t *begin, const uint8_t *end) : _pos(begin), _end(end) {}
+
+    // getters / setters
+    const uint8_t *getPosition() const { return _pos; }
+    size_t getRemaining() const { return _pos < _end ? _end - _pos : 0; }
+    bool isAtEnd() const { return _pos >= _end; }
+
+    // typical behaviour methods
+    template <class T>
+    T get()
+    {
+        if (getRemaining() < sizeof(T))
+        {
+            throwOverrun();
+        }
+        T value;
+        std::memcpy(&value, _pos, sizeof(T));
+        _pos += sizeof(T);
+        return value;
+    }
+
+    bool getMagic(const char magic[4])
+    {
+        bool isMatch = getRemaining() >= 4 && std::memcmp(_pos, magic, 4) == 0;
+        _pos += isMatch ? 4 : 0;
+        return isMatch;
+    }
+
+    uint64_t getVarint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (_pos >= _end)
+            {
+                throwOverrun();
+            }
+            uint8_t byte = *_pos++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw std::runtime_error("malformed varint");
+    }
+
+    int64_t getZigzag()
+    {
+        uint64_t value = getVarint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    // returns a number of elements read from the data, each of which takes at least minBytes bytes, so that
+    // a corrupted count is rejected before anything is allocated for it
+    uint64_t checkCount(uint64_t count, size_t minBytes)
+    {
+        if (count > getRemaining() / minBytes)
+        {
+            throwOverrun();
+        }
+        return count;
+    }
+    uint64_t getCount(size_t minBytes) { return checkCount(getVarint(), minBytes); }
+
+    // returns an id read from the data after checking it against the number of objects it refers to
+    static uint64_t checkID(uint64_t id, size_t nObjects)
+    {
+        if (id >= nObjects)
+        {
+            throw std::runtime_error("id " + std::to_string(id) + " out of range");
+        }
+        return id;
+    }
+
+private:
+    [[noreturn]] static void throwOverrun() { throw std::runtime_error("unexpected end of data"); }
+
+    const uint8_t *_pos;
+    const uint8_t *_end;
+};
+
+#endif
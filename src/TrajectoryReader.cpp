@@ -0,0 +1,234 @@
+#include <stdexcept>
+#include <algorithm>
+#include "TrajectoryReader.h"
+
+/* Implementation of class "TrajectoryReader" */
+
+TrajectoryReader::TrajectoryReader(const std::string &filename) : _file(filename), _reader(nullptr, nullptr)
+{
+    _data = _file.getData();
+    _size = _file.getSize();
+
+    // read the static network from the header
+    ByteReader reader(_data, _data + _size);
+    if (!reader.getMagic(trajectoryMagic))
+    {
+        throw std::runtime_error("Not a trajectory log: " + filename);
+    }
+    _seed = reader.get<uint64_t>();
+    _tickDuration = reader.get<double>();
+    uint32_t nIntersections = reader.checkCount(reader.get<uint32_t>(), 16);
+    for (uint32_t i = 0; i < nIntersections; i++)
+    {
+        _intersectionX.push_back(reader.get<double>());
+        _intersectionY.push_back(reader.get<double>());
+    }
+    uint32_t nStreets = reader.checkCount(reader.get<uint32_t>(), 16);
+    for (uint32_t i = 0; i < nStreets; i++)
+    {
+        _streetIn.push_back(ByteReader::checkID(reader.get<int32_t>(), nIntersections));
+        _streetOut.push_back(ByteReader::checkID(reader.get<int32_t>(), nIntersections));
+        _streetLength.push_back(reader.get<double>());
+    }
+
+    // every vehicle takes at least 5 bytes in the key frame of a chunk
+    _vehicles.resize(reader.checkCount(reader.get<uint32_t>(), 5));
+    _phases.resize(nIntersections);
+
+    buildIndex(reader.getPosition());
+    if (_index.empty())
+    {
+        throw std::runtime_error("Trajectory log contains no data: " + filename);
+    }
+    seek(getFirstTick());
+}
+
+// reads the chunk index from the end of the log, or recovers it by walking the chunks of a log which was not closed
+void TrajectoryReader::buildIndex(const uint8_t *begin)
+{
+    if (_size >= footerSize + (begin - _data) && std::equal(footerMagic, footerMagic + 4, _data + _size - 4))
+    {
+        ByteReader footer(_data + _size - footerSize, _data + _size);
+        uint64_t indexOffset = footer.get<uint64_t>();
+        _lastTick = footer.get<int64_t>();
+        ByteReader reader(_data + std::min<uint64_t>(indexOffset, _size), _data + _size);
+        if (reader.getMagic(indexMagic))
+        {
+            uint32_t nChunks = reader.checkCount(reader.get<uint32_t>(), 16);
+            for (uint32_t i = 0; i < nChunks; i++)
+            {
+                int64_t tick = reader.get<int64_t>();
+                _index.emplace_back(tick, ByteReader::checkID(reader.get<uint64_t>(), indexOffset));
+            }
+            return;
+        }
+    }
+
+    // a truncated chunk at the end is ignored, the last tick is found by decoding the last complete chunk
+    const uint8_t *pos = begin;
+    while ((size_t)(_data + _size - pos) >= chunkHeaderSize)
+    {
+        ByteReader reader(pos, _data + _size);
+        if (!reader.getMagic(chunkMagic))
+        {
+            break;
+        }
+        uint32_t payloadSize = reader.get<uint32_t>();
+        int64_t tick = reader.get<int64_t>();
+        if ((size_t)(_data + _size - reader.getPosition()) < payloadSize)
+        {
+            break;
+        }
+        _index.emplace_back(tick, pos - _data);
+        pos = reader.getPosition() + payloadSize;
+    }
+    _lastTick = -1;
+    if (!_index.empty())
+    {
+        loadChunk(_index.size() - 1);
+        while (_nextRecordTick >= 0)
+        {
+            applyRecord();
+        }
+        _lastTick = _recordTick;
+    }
+}
+
+// decodes the key frame of a chunk and positions the cursor at its first delta record
+void TrajectoryReader::loadChunk(size_t chunkIdx)
+{
+    _chunkIdx = chunkIdx;
+    ByteReader header(_data + _index[chunkIdx].second, _data + _size);
+    if (!header.getMagic(chunkMagic))
+    {
+        throw std::runtime_error("Trajectory log is corrupt: chunk " + std::to_string(chunkIdx) + " not found");
+    }
+    uint32_t payloadSize = header.checkCount(header.get<uint32_t>(), 1);
+    _recordTick = header.get<int64_t>();
+    _tick = _recordTick;
+    _reader = ByteReader(header.getPosition(), header.getPosition() + payloadSize);
+
+    for (VehicleRecord &record : _vehicles)
+    {
+        record.streetID = ByteReader::checkID(_reader.getVarint(), _streetIn.size());
+        record.destinationID = ByteReader::checkID(_reader.getVarint(), _phases.size());
+        record.posStreet = _reader.getZigzag();
+        record.speed = _reader.getZigzag();
+        record.state = _reader.get<uint8_t>();
+    }
+    for (uint8_t &phase : _phases)
+    {
+        phase = _reader.get<uint8_t>();
+    }
+    readRecordTick();
+}
+
+void TrajectoryReader::readRecordTick()
+{
+    _nextRecordTick = _reader.isAtEnd() ? -1 : _recordTick + (long)_reader.getVarint();
+}
+
+void TrajectoryReader::applyRecord()
+{
+    uint64_t nVehicleChanges = _reader.getCount(2);
+    int vehicleID = 0;
+    for (uint64_t i = 0; i < nVehicleChanges; i++)
+    {
+        vehicleID = ByteReader::checkID(vehicleID + _reader.getVarint(), _vehicles.size());
+        VehicleRecord &record = _vehicles[vehicleID];
+        uint8_t fields = _reader.get<uint8_t>();
+        if (fields & fieldStreet)
+        {
+            record.streetID = ByteReader::checkID(_reader.getVarint(), _streetIn.size());
+            record.destinationID = ByteReader::checkID(_reader.getVarint(), _phases.size());
+        }
+        if (fields & fieldPosition)
+        {
+            record.posStreet += _reader.getZigzag();
+        }
+        if (fields & fieldSpeed)
+        {
+            record.speed += _reader.getZigzag();
+        }
+        if (fields & fieldState)
+        {
+            record.state = _reader.get<uint8_t>();
+        }
+    }
+
+    uint64_t nLightChanges = _reader.getCount(2);
+    int intersectionID = 0;
+    for (uint64_t i = 0; i < nLightChanges; i++)
+    {
+        intersectionID = ByteReader::checkID(intersectionID + _reader.getVarint(), _phases.size());
+        _phases[intersectionID] = _reader.get<uint8_t>();
+    }
+
+    _recordTick = _nextRecordTick;
+    readRecordTick();
+}
+
+void TrajectoryReader::seek(long tick)
+{
+    // find the last chunk starting at or before the tick
+    auto chunk = std::upper_bound(_index.begin(), _index.end(), tick, [](long t, const std::pair<int64_t, uint64_t> &entry) {
+        return t < entry.first;
+    });
+    loadChunk(chunk == _index.begin() ? 0 : chunk - _index.begin() - 1);
+    advanceTo(tick);
+}
+
+bool TrajectoryReader::advanceTo(long tick)
+{
+    while (true)
+    {
+        // apply all records of the current chunk up to the tick
+        while (_nextRecordTick >= 0 && _nextRecordTick <= tick)
+        {
+            applyRecord();
+        }
+
+        // continue with the next chunk if the current one ends before the tick
+        if (_nextRecordTick < 0 && _chunkIdx + 1 < _index.size() && _index[_chunkIdx + 1].first <= tick)
+        {
+            loadChunk(_chunkIdx + 1);
+            continue;
+        }
+        break;
+    }
+    _tick = std::max(_tick, std::min(tick, _lastTick));
+    return tick <= _lastTick;
+}
+
+void TrajectoryReader::writeSnapshot(Snapshot &snapshot)
+{
+    snapshot.objects.resize(_phases.size() + _vehicles.size());
+    snapshot.simulationTime = _tick * _tickDuration;
+    size_t idx = 0;
+    for (size_t id = 0; id < _phases.size(); id++)
+    {
+        SnapshotObject &object = snapshot.objects[idx++];
+        object.x = _intersectionX[id];
+        object.y = _intersectionY[id];
+        object.type = ObjectType::objectIntersection;
+        object.phase = (TrafficLightPhase)_phases[id];
+        object.color[0] = 0;
+        object.color[1] = object.phase == TrafficLightPhase::green ? 255 : 0;
+        object.color[2] = object.phase == TrafficLightPhase::green ? 0 : 255;
+    }
+    for (size_t id = 0; id < _vehicles.size(); id++)
+    {
+        // interpolate between the intersection the vehicle comes from and its destination
+        const VehicleRecord &record = _vehicles[id];
+        int destinationID = record.destinationID;
+        int originID = _streetIn[record.streetID] == destinationID ? _streetOut[record.streetID] : _streetIn[record.streetID];
+        double completion = VehicleRecord::dequantize(record.posStreet) / _streetLength[record.streetID];
+
+        SnapshotObject &object = snapshot.objects[idx++];
+        object.x = _intersectionX[originID] + completion * (_intersectionX[destinationID] - _intersectionX[originID]);
+        object.y = _intersectionY[originID] + completion * (_intersectionY[destinationID] - _intersectionY[originID]);
+        object.type = ObjectType::objectVehicle;
+        object.phase = TrafficLightPhase::red;
+        getVehicleColor(id, object.color);
+    }
+}
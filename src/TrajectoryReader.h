@@ -0,0 +1,64 @@
+#ifndef TRAJECTORYREADER_H
+#define TRAJECTORYREADER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "MappedFile.h"
+#include "TrajectoryFormat.h"
+#include "TrafficLight.h"
+#include "Snapshot.h"
+
+// replays a trajectory log written by TrajectoryRecorder without re-simulating. The file is memory-mapped,
+// so only the chunks actually visited are paged in, and seeking to a tick is a binary search over the chunk
+// index followed by decoding a single chunk from its key frame. A log which is corrupted rather than merely
+// truncated makes the reader throw std::runtime_error, also while seeking or advancing.
+class TrajectoryReader
+{
+public:
+    // constructor / desctructor
+    TrajectoryReader(const std::string &filename);
+
+    // getters / setters
+    uint64_t getSeed() { return _seed; }
+    double getTickDuration() { return _tickDuration; }
+    long getFirstTick() { return _index.empty() ? 0 : _index.front().first; }
+    long getLastTick() { return _lastTick; }
+    long getTick() { return _tick; } // tick of the current state
+    int getNumVehicles() { return _vehicles.size(); }
+    int getNumIntersections() { return _phases.size(); }
+    const VehicleRecord &getVehicle(int vehicleID) { return _vehicles[vehicleID]; }
+    TrafficLightPhase getPhase(int intersectionID) { return (TrafficLightPhase)_phases[intersectionID]; }
+
+    // typical behaviour methods
+    void seek(long tick);                   // moves to the state after the given tick, in any direction
+    bool advanceTo(long tick);              // moves forward to the state after the given tick, false beyond the last tick
+    void writeSnapshot(Snapshot &snapshot); // pixel positions and colors of the current state, e.g. for Graphics
+
+private:
+    // typical behaviour methods
+    void buildIndex(const uint8_t *begin);
+    void loadChunk(size_t chunkIdx);
+    void readRecordTick();
+    void applyRecord();
+
+    MappedFile _file;                                     // memory-mapped log
+    const uint8_t *_data;                                 // first byte of the log
+    size_t _size;                                         // size of the log in bytes
+    uint64_t _seed;                                       // seed of the recorded run
+    double _tickDuration;                                 // simulated time per tick in s
+    std::vector<double> _intersectionX, _intersectionY;   // pixel positions of all intersections
+    std::vector<int32_t> _streetIn, _streetOut;           // intersections at both ends of all streets
+    std::vector<double> _streetLength;                    // lengths of all streets in m
+    std::vector<std::pair<int64_t, uint64_t>> _index;     // first tick and file offset of every chunk
+    long _lastTick;                                       // latest tick covered by the log
+    std::vector<VehicleRecord> _vehicles;                 // current vehicle states
+    std::vector<uint8_t> _phases;                         // current traffic light phases
+    size_t _chunkIdx;                                     // chunk being decoded
+    ByteReader _reader;                                   // position within the chunk being decoded
+    long _tick;                                           // tick of the current state
+    long _recordTick;                                     // tick of the latest record applied
+    long _nextRecordTick;                                 // tick of the next record in the chunk, -1 at its end
+};
+
+#endif
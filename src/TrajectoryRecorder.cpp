@@ -0,0 +1,283 @@
+#include <stdexcept>
+#include <algorithm>
+#include "World.h"
+#include "TrajectoryRecorder.h"
+#include "Logger.h"
+
+/* Implementation of class "TrajectoryRecorder" */
+
+TrajectoryRecorder::TrajectoryRecorder(World &world, const std::string &filename, double tickDuration, size_t chunkSize,
+                                       size_t memoryBudget)
+    : _world(world), _fullChunks(std::max<size_t>(4, memoryBudget / chunkSize)),
+      _freeChunks(std::max<size_t>(4, memoryBudget / chunkSize))
+{
+    _file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!_file)
+    {
+        throw std::runtime_error("Cannot open trajectory log " + filename);
+    }
+    _chunkSize = chunkSize;
+    _chunk.reserve(chunkSize + (chunkSize >> 2));
+    _chunkTick = -1;
+    _recordTick = -1;
+    _lastTick = -1;
+    _nDroppedChunks = 0;
+    _isOpen = true;
+
+    // the header holds the static network, so that the log can be replayed without the map
+    std::vector<uint8_t> header;
+    ByteWriter writer(header);
+    writer.putBytes(trajectoryMagic, 4);
+    writer.put<uint64_t>(world.getSeed());
+    writer.put<double>(tickDuration);
+    writer.put<uint32_t>(world.getIntersections().size());
+    for (auto &intersection : world.getIntersections())
+    {
+        double x, y;
+        intersection->getPosition(x, y);
+        writer.put<double>(x);
+        writer.put<double>(y);
+    }
+    writer.put<uint32_t>(world.getStreets().size());
+    for (auto &street : world.getStreets())
+    {
+        writer.put<int32_t>(street->getInIntersectionID());
+        writer.put<int32_t>(street->getOutIntersectionID());
+        writer.put<double>(street->getLength());
+    }
+    writer.put<uint32_t>(world.getVehicles().size());
+    _file.write((const char *)header.data(), header.size());
+    _offset = header.size();
+
+    _vehicles.resize(world.getVehicles().size());
+    _phases.resize(world.getIntersections().size());
+    _writer = std::thread(&TrajectoryRecorder::writeChunks, this);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    close();
+}
+
+void TrajectoryRecorder::readVehicle(int vehicleID, VehicleRecord &record)
+{
+    Vehicle &vehicle = _world.getVehicle(vehicleID);
+    record.streetID = vehicle.getCurrentStreetID();
+    record.destinationID = vehicle.getCurrentDestinationID();
+    record.posStreet = VehicleRecord::quantize(vehicle.getPositionOnStreet());
+    record.speed = VehicleRecord::quantize(vehicle.getSpeed());
+    record.state = vehicle.isWaitingForEntry() ? VehicleState::stateWaiting
+                   : vehicle.hasEnteredIntersection() ? VehicleState::stateCrossing
+                                                      : VehicleState::stateDriving;
+}
+
+void TrajectoryRecorder::recordTick(long tick)
+{
+    if (!_isOpen)
+    {
+        return;
+    }
+    _lastTick = tick;
+    if (_chunkTick < 0)
+    {
+        startChunk(tick);
+        return;
+    }
+
+    // encode every vehicle which changed since the previous record
+    _vehicleChanges.clear();
+    ByteWriter vehicleWriter(_vehicleChanges);
+    int nVehicleChanges = 0, prevVehicleID = 0;
+    VehicleRecord record;
+    for (size_t id = 0; id < _vehicles.size(); id++)
+    {
+        readVehicle(id, record);
+        VehicleRecord &prev = _vehicles[id];
+        uint8_t fields = 0;
+        fields |= record.streetID != prev.streetID || record.destinationID != prev.destinationID ? fieldStreet : 0;
+        fields |= record.posStreet != prev.posStreet ? fieldPosition : 0;
+        fields |= record.speed != prev.speed ? fieldSpeed : 0;
+        fields |= record.state != prev.state ? fieldState : 0;
+        if (fields == 0)
+        {
+            continue;
+        }
+
+        vehicleWriter.putVarint(id - prevVehicleID);
+        vehicleWriter.put<uint8_t>(fields);
+        if (fields & fieldStreet)
+        {
+            vehicleWriter.putVarint(record.streetID);
+            vehicleWriter.putVarint(record.destinationID);
+        }
+        if (fields & fieldPosition)
+        {
+            vehicleWriter.putZigzag(record.posStreet - prev.posStreet);
+        }
+        if (fields & fieldSpeed)
+        {
+            vehicleWriter.putZigzag(record.speed - prev.speed);
+        }
+        if (fields & fieldState)
+        {
+            vehicleWriter.put<uint8_t>(record.state);
+        }
+        prev = record;
+        prevVehicleID = id;
+        nVehicleChanges++;
+    }
+
+    // encode every traffic light which changed its phase
+    _lightChanges.clear();
+    ByteWriter lightWriter(_lightChanges);
+    int nLightChanges = 0, prevIntersectionID = 0;
+    std::vector<std::shared_ptr<Intersection>> &intersections = _world.getIntersections();
+    for (size_t id = 0; id < intersections.size(); id++)
+    {
+        uint8_t phase = intersections[id]->trafficLightIsGreen() ? TrafficLightPhase::green : TrafficLightPhase::red;
+        if (phase != _phases[id])
+        {
+            lightWriter.putVarint(id - prevIntersectionID);
+            lightWriter.put<uint8_t>(phase);
+            _phases[id] = phase;
+            prevIntersectionID = id;
+            nLightChanges++;
+        }
+    }
+
+    // ticks without any change are not stored at all
+    if (nVehicleChanges == 0 && nLightChanges == 0)
+    {
+        return;
+    }
+    ByteWriter writer(_chunk);
+    writer.putVarint(tick - _recordTick);
+    writer.putVarint(nVehicleChanges);
+    _chunk.insert(_chunk.end(), _vehicleChanges.begin(), _vehicleChanges.end());
+    writer.putVarint(nLightChanges);
+    _chunk.insert(_chunk.end(), _lightChanges.begin(), _lightChanges.end());
+    _recordTick = tick;
+
+    if (_chunk.size() - chunkHeaderSize >= _chunkSize)
+    {
+        writeChunk();
+    }
+}
+
+// opens a new chunk with a key frame, from which a reader can start without any earlier chunk
+void TrajectoryRecorder::startChunk(long tick)
+{
+    _chunkTick = tick;
+    _recordTick = tick;
+
+    // the payload size is filled in once the chunk is full
+    ByteWriter writer(_chunk);
+    writer.putBytes(chunkMagic, 4);
+    writer.put<uint32_t>(0);
+    writer.put<int64_t>(tick);
+    for (size_t id = 0; id < _vehicles.size(); id++)
+    {
+        VehicleRecord &record = _vehicles[id];
+        readVehicle(id, record);
+        writer.putVarint(record.streetID);
+        writer.putVarint(record.destinationID);
+        writer.putZigzag(record.posStreet);
+        writer.putZigzag(record.speed);
+        writer.put<uint8_t>(record.state);
+    }
+    std::vector<std::shared_ptr<Intersection>> &intersections = _world.getIntersections();
+    for (size_t id = 0; id < intersections.size(); id++)
+    {
+        _phases[id] = intersections[id]->trafficLightIsGreen() ? TrafficLightPhase::green : TrafficLightPhase::red;
+        writer.put<uint8_t>(_phases[id]);
+    }
+}
+
+// completes the header of the chunk and hands it to the writer thread, called on the recording thread. Only the
+// final chunk may wait for the writer thread, all others are dropped if its queue is full.
+void TrajectoryRecorder::writeChunk(bool isFinal)
+{
+    size_t size = _chunk.size();
+    uint32_t payloadSize = size - chunkHeaderSize;
+    std::memcpy(_chunk.data() + 4, &payloadSize, sizeof(payloadSize));
+
+    // continue with a chunk which has been written before, if there is one
+    std::vector<uint8_t> chunk;
+    if (!_freeChunks.tryReceive(chunk))
+    {
+        chunk.reserve(_chunk.capacity());
+    }
+    _chunk.swap(chunk);
+    if (isFinal)
+    {
+        _fullChunks.send(std::move(chunk));
+    }
+    else if (!_fullChunks.trySend(chunk))
+    {
+        // the chunk is still ours, reuse its buffer for the next one
+        _chunk.swap(chunk);
+        _chunk.clear();
+        _nDroppedChunks++;
+        LOG_WARNING("TrajectoryRecorder: dropped the chunk starting at tick {}, the file cannot keep up", _chunkTick);
+        _chunkTick = -1;
+        return;
+    }
+    _index.emplace_back(_chunkTick, _offset);
+    _offset += size;
+    _chunkTick = -1;
+}
+
+// function which is executed by the writer thread
+void TrajectoryRecorder::writeChunks()
+{
+    bool hasFailed = false;
+    while (true)
+    {
+        std::vector<uint8_t> chunk = _fullChunks.receive();
+        if (chunk.empty())
+        {
+            break;
+        }
+        _file.write((const char *)chunk.data(), chunk.size());
+        if (!_file && !hasFailed)
+        {
+            LOG_ERROR("TrajectoryRecorder: cannot write chunk of {} bytes", chunk.size());
+            hasFailed = true;
+        }
+        chunk.clear();
+        _freeChunks.trySend(chunk);
+    }
+}
+
+void TrajectoryRecorder::close()
+{
+    if (!_isOpen)
+    {
+        return;
+    }
+    if (_chunkTick >= 0)
+    {
+        writeChunk(true);
+    }
+    _fullChunks.send(std::vector<uint8_t>());
+    _writer.join();
+
+    // the index of all chunks and the footer pointing to it make seeking a binary search
+    std::vector<uint8_t> trailer;
+    ByteWriter writer(trailer);
+    uint64_t indexOffset = _offset;
+    writer.putBytes(indexMagic, 4);
+    writer.put<uint32_t>(_index.size());
+    for (auto &entry : _index)
+    {
+        writer.put<int64_t>(entry.first);
+        writer.put<uint64_t>(entry.second);
+    }
+    writer.put<uint64_t>(indexOffset);
+    writer.put<int64_t>(_lastTick);
+    writer.putBytes(footerMagic, 4);
+    _file.write((const char *)trailer.data(), trailer.size());
+    _offset += trailer.size();
+    _file.close();
+    _isOpen = false;
+}
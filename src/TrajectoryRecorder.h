@@ -0,0 +1,63 @@
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <cstdint>
+#include "TrajectoryFormat.h"
+#include "MessageQueue.h"
+
+// forward declarations to avoid include cycle
+class World;
+
+// streams the state of all vehicles and traffic lights into an append-only binary log (see TrajectoryFormat.h).
+// Every tick only the changes since the previous tick are encoded into an in-memory chunk, which is handed to
+// a writer thread once it is full, so recording never waits for the file, not even when a chunk is written.
+// Up to memoryBudget bytes of chunks queue up behind a slow disk. A chunk which finds the queue full is dropped
+// with a warning : the log stays valid, as every chunk starts with a key frame, but a replay skips its ticks.
+class TrajectoryRecorder
+{
+public:
+    // constructor / desctructor
+    TrajectoryRecorder(World &world, const std::string &filename, double tickDuration, size_t chunkSize = 1 << 20,
+                       size_t memoryBudget = 64 << 20);
+    ~TrajectoryRecorder();
+
+    // getters / setters
+    uint64_t getNumBytesWritten() { return _offset; }
+    long getNumDroppedChunks() { return _nDroppedChunks; }
+
+    // typical behaviour methods
+    void recordTick(long tick); // appends the state after the given tick, must not overlap with the tick itself
+    void close();               // writes the pending chunk, the chunk index and the footer
+
+private:
+    // typical behaviour methods
+    void readVehicle(int vehicleID, VehicleRecord &record);
+    void startChunk(long tick);
+    void writeChunk(bool isFinal = false);
+    void writeChunks();
+
+    World &_world;
+    std::ofstream _file;
+    std::vector<uint8_t> _chunk;                      // header and payload of the chunk being filled
+    MpscRingQueue<std::vector<uint8_t>> _fullChunks;  // chunks waiting to be written, an empty one ends the writer thread
+    MpscRingQueue<std::vector<uint8_t>> _freeChunks;  // written chunks handed back for reuse, so that recording does not allocate
+    std::thread _writer;                              // writes full chunks to the file in the order in which they were filled
+    std::vector<uint8_t> _vehicleChanges;             // scratch buffer for the vehicle part of a delta record
+    std::vector<uint8_t> _lightChanges;               // scratch buffer for the traffic light part of a delta record
+    size_t _chunkSize;                                // payload size in bytes after which a chunk is written
+    long _chunkTick;                                  // first tick of the chunk being filled
+    long _recordTick;                                 // tick of the latest key frame or delta record
+    long _lastTick;                                   // latest recorded tick
+    std::vector<VehicleRecord> _vehicles;             // vehicle states as of the latest record
+    std::vector<uint8_t> _phases;                     // traffic light phases as of the latest record
+    std::vector<std::pair<int64_t, uint64_t>> _index; // first tick and file offset of every chunk written
+    uint64_t _offset;                                 // number of bytes written to the file so far
+    long _nDroppedChunks;                             // chunks dropped because the writer thread lagged behind
+    bool _isOpen;
+};
+
+#endif
@@ -1,22 +1,41 @@
 #include <iostream>
 #include <random>
-#include "Street.h"
-#include "Intersection.h"
-#include "Vehicle.h"
+#include <stdexcept>
+#include "World.h"
+#include "VehicleTable.h"
+#include "TrajectoryFormat.h"
+#include "Logger.h"
 
-Vehicle::Vehicle()
+Vehicle::Vehicle(World &world)
 {
-    _currStreet = nullptr;
+    _world = &world;
+    _currStreetID = -1;
+    _currDestinationID = -1;
+    _currEdge = nullptr;
+    _nextEdge = nullptr;
+    static const uint64_t processSeed = std::random_device()(); // see TrafficLight, replaced by World::addVehicle
+    _random = RandomStream(processSeed, getID());
     _posStreet = 0.0;
     _type = ObjectType::objectVehicle;
     _speed = 400; // m/s
+    _hasEnteredIntersection = false;
+    _isWaitingForEntry = false;
+    _table = nullptr;
+    _slot = -1;
+    _lane = nullptr;
+    _laneSeq = 0;
 }
 
 
-void Vehicle::setCurrentDestination(std::shared_ptr<Intersection> destination)
+void Vehicle::setCurrentStreet(Street &street)
+{
+    _currStreetID = street.getID();
+}
+
+void Vehicle::setCurrentDestination(Intersection &destination)
 {
     // update destination
-    _currDestination = destination;
+    _currDestinationID = destination.getID();
 
     // reset simulation parameters
     _posStreet = 0.0;
@@ -28,16 +47,225 @@ void Vehicle::simulate()
     threads.emplace_back(std::thread(&Vehicle::drive, this));
 }
 
+void Vehicle::getPosition(double &x, double &y)
+{
+    if (_table)
+    {
+        _table->getPosition(_slot, x, y);
+    }
+    else
+    {
+        TrafficObject::getPosition(x, y);
+    }
+}
+
+double Vehicle::getPositionOnStreet()
+{
+    return _table ? _table->getPosStreet(_slot) : _posStreet;
+}
+
+double Vehicle::getSpeed()
+{
+    return _table ? _table->getSpeed(_slot) : _speed;
+}
+
+void Vehicle::attachToTable(VehicleTable *table, int slot)
+{
+    _table = table;
+    _slot = slot;
+    _table->setSpeed(_slot, 0.0);
+    _table->setDesiredSpeed(_slot, _speed);
+    updateEdge();
+}
+
+void Vehicle::followRow(VehicleTable *table, int slot)
+{
+    _table = table;
+    _slot = slot;
+}
+
+// looks up the road graph edge which leads along the current street to the current destination
+void Vehicle::updateEdge()
+{
+    Street &street = _world->getStreet(_currStreetID);
+    int originID = _currDestinationID == street.getInIntersectionID() ? street.getOutIntersectionID() : street.getInIntersectionID();
+    _currEdge = &_world->getRoadGraph().findEdge(originID, _currStreetID);
+
+    if (_table)
+    {
+        _table->setSegment(_slot, _currEdge->streetID, _currEdge->length, _currEdge->x1, _currEdge->y1, _currEdge->x2, _currEdge->y2);
+    }
+}
+
+// joins the lane whose last vehicle is furthest ahead, so that vehicles entering a street spread over its lanes
+void Vehicle::enterLane()
+{
+    Street &street = _world->getStreet(_currStreetID);
+    int bestLane = 0;
+    double bestBackPos = 0.0;
+    for (int lane = 0; lane < street.getNumLanes(); lane++)
+    {
+        Lane &candidate = street.getLane(_currDestinationID, lane);
+        if (candidate.getSize() == 0)
+        {
+            bestLane = lane;
+            break;
+        }
+        double backPos = _world->getVehicle(candidate.getBack()).getPositionOnStreet();
+        if (lane == 0 || backPos > bestBackPos)
+        {
+            bestLane = lane;
+            bestBackPos = backPos;
+        }
+    }
+    enterLane(bestLane);
+}
+
+void Vehicle::enterLane(int lane)
+{
+    _lane = &_world->getStreet(_currStreetID).getLane(_currDestinationID, lane);
+    _laneSeq = _lane->pushBack(_id);
+}
+
+// the obstacle is the rear of the vehicle ahead in the lane or, until entry has been granted, the stop line in front of the destination
+void Vehicle::updateObstacle()
+{
+    const DrivingModel &model = _table->getDrivingModel();
+    double obstaclePos = _hasEnteredIntersection ? 2.0 * _currEdge->length : 0.9 * _currEdge->length;
+    double obstacleSpeed = 0.0;
+    int leaderID = _lane->getLeader(_laneSeq);
+    if (leaderID >= 0)
+    {
+        // the leader drives towards the same intersection, so it is held by the same table
+        Vehicle &leader = _world->getVehicle(leaderID);
+        double leaderRear = leader.getPositionOnStreet() - model.vehicleLength;
+        if (leaderRear < obstaclePos)
+        {
+            obstaclePos = leaderRear;
+            obstacleSpeed = leader.getSpeed();
+        }
+    }
+    _table->setObstacle(_slot, obstaclePos, obstacleSpeed);
+}
+
+// reacts to the position integrated by the table without blocking the calling worker thread
+void Vehicle::step()
+{
+    // a vehicle with a pending entry request keeps braking for the stop line until the intersection grants it
+    if (_isWaitingForEntry)
+    {
+        if (!_entryWaiter.isGranted())
+        {
+            return;
+        }
+        _isWaitingForEntry = false;
+
+        // cross at reduced speed and set intersection flag
+        _table->setDesiredSpeed(_slot, _speed / 10.0);
+        _hasEnteredIntersection = true;
+    }
+
+    // check wether the vehicle has pulled up to the stop line in front of its destination as the first of its lane
+    double stopPos = 0.9 * _currEdge->length;
+    if (!_hasEnteredIntersection && _table->getPosStreet(_slot) >= stopPos - 2.0 * _table->getDrivingModel().minGap && _lane->getFront() == _id)
+    {
+        // request entry to the current intersection for the chosen movement and poll for it in the following steps
+        int approach, exit;
+        chooseNextEdge(approach, exit);
+        _world->getIntersection(_currDestinationID).requestEntry(_id, approach, exit, _entryWaiter);
+        _isWaitingForEntry = true;
+    }
+
+    // check wether intersection has been crossed, vehicles leave their lane in order
+    if (_table->getCompletion(_slot) >= 1.0 && _hasEnteredIntersection && _lane->getFront() == _id)
+    {
+        turnIntoNextStreet();
+    }
+}
+
+// bits of the flags of a saved vehicle
+static const uint8_t flagEntered = 1;  // _hasEnteredIntersection
+static const uint8_t flagWaiting = 2;  // _isWaitingForEntry
+static const uint8_t flagGranted = 4;  // the pending entry request has been granted and not been noticed yet
+
+void Vehicle::saveState(ByteWriter &writer)
+{
+    writer.putVarint(_currStreetID);
+    writer.putVarint(_currDestinationID);
+
+    // the street chosen on requesting entry, as exit of the destination counted from 1, 0 for none
+    bool hasNextEdge = _hasEnteredIntersection || _isWaitingForEntry;
+    writer.putVarint(hasNextEdge ? _nextEdge - _world->getRoadGraph().getEdges(_currDestinationID) + 1 : 0);
+    writer.put<uint64_t>(_random.getKey());
+    writer.putVarint(_random.getCounter());
+    writer.put<double>(_speed);
+    writer.put<uint8_t>((_hasEnteredIntersection ? flagEntered : 0) | (_isWaitingForEntry ? flagWaiting : 0) |
+                        (_entryWaiter.isGranted() ? flagGranted : 0));
+}
+
+// the motion state is saved bit for bit, so that a restored run continues exactly like the original one
+void Vehicle::saveMotion(ByteWriter &writer)
+{
+    VehicleRow row;
+    _table->getRow(_slot, row);
+    writer.put<double>(row.posStreet);
+    writer.put<double>(row.speed);
+    writer.put<double>(row.desiredSpeed);
+    writer.put<double>(row.completion);
+    writer.put<double>(row.posX);
+    writer.put<double>(row.posY);
+}
+
+void Vehicle::restoreState(ByteReader &reader)
+{
+    // the destination must be an end of the street and the exit one of the destination, else the vehicle would leave the map
+    _currStreetID = ByteReader::checkID(reader.getVarint(), _world->getStreets().size());
+    _currDestinationID = reader.getVarint();
+    Street &street = _world->getStreet(_currStreetID);
+    if (_currDestinationID != street.getInIntersectionID() && _currDestinationID != street.getOutIntersectionID())
+    {
+        throw std::runtime_error("Vehicle #" + std::to_string(_id) + " drives towards an intersection off its street");
+    }
+    const RoadGraph &roadGraph = _world->getRoadGraph();
+    long nextExit = (long)ByteReader::checkID(reader.getVarint(), roadGraph.getDegree(_currDestinationID) + 1) - 1;
+    _nextEdge = nextExit >= 0 ? roadGraph.getEdges(_currDestinationID) + nextExit : nullptr;
+    uint64_t key = reader.get<uint64_t>();
+    _random.setState(key, reader.getVarint());
+    _speed = reader.get<double>();
+
+    uint8_t flags = reader.get<uint8_t>();
+    _hasEnteredIntersection = (flags & flagEntered) != 0;
+    _isWaitingForEntry = (flags & flagWaiting) != 0;
+    _entryWaiter.reset();
+    if (flags & flagGranted)
+    {
+        _entryWaiter.grant();
+    }
+    _table = nullptr;
+    _lane = nullptr;
+}
+
+// attaching has moved the row onto the saved street, only its motion state is left to overwrite
+void Vehicle::restoreMotion(ByteReader &reader)
+{
+    VehicleRow row;
+    _table->getRow(_slot, row);
+    row.posStreet = reader.get<double>();
+    row.speed = reader.get<double>();
+    row.desiredSpeed = reader.get<double>();
+    row.completion = reader.get<double>();
+    row.posX = reader.get<double>();
+    row.posY = reader.get<double>();
+    _table->setRow(_slot, row);
+}
+
 // virtual function which is executed in a thread
 void Vehicle::drive()
 {
-    // print id of the current thread
-    std::unique_lock<std::mutex> lck(_mtx);
-    std::cout << "Vehicle #" << _id << "::drive: thread id = " << std::this_thread::get_id() << std::endl;
-    lck.unlock();
+    LOG_INFO("Vehicle #{}::drive: started", _id);
 
     // initalize variables
-    bool hasEnteredIntersection = false;
+    updateEdge();
     double cycleDuration = 1; // duration of a single simulation cycle in ms
     std::chrono::time_point<std::chrono::system_clock> lastUpdate;
 
@@ -52,74 +280,26 @@ void Vehicle::drive()
         long timeSinceLastUpdate = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - lastUpdate).count();
         if (timeSinceLastUpdate >= cycleDuration)
         {
-            // update position with a constant velocity motion model
-            _posStreet += _speed * timeSinceLastUpdate / 1000;
-
-            // compute completion rate of current street
-            double completion = _posStreet / _currStreet->getLength();
-
-            // compute current pixel position on street based on driving direction
-            std::shared_ptr<Intersection> i1, i2;
-            i2 = _currDestination;
-            i1 = i2->getID() == _currStreet->getInIntersection()->getID() ? _currStreet->getOutIntersection() : _currStreet->getInIntersection();
-
-            double x1, y1, x2, y2, xv, yv, dx, dy, l;
-            i1->getPosition(x1, y1);
-            i2->getPosition(x2, y2);
-            dx = x2 - x1;
-            dy = y2 - y1;
-            l = sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (x1 - x2));
-            xv = x1 + completion * dx; // new position based on line equation in parameter form
-            yv = y1 + completion * dy;
-            this->setPosition(xv, yv);
+            double completion = moveAlongStreet(timeSinceLastUpdate / 1000.0);
 
             // check wether halting position in front of destination has been reached
-            if (completion >= 0.9 && !hasEnteredIntersection)
+            if (completion >= 0.9 && !_hasEnteredIntersection)
             {
-                // request entry to the current intersection (using async)
-                auto ftrEntryGranted = std::async(&Intersection::addVehicleToQueue, _currDestination, get_shared_this());
-
-                // wait until entry has been granted
-                ftrEntryGranted.get();
+                // request entry to the current intersection and wait on this thread until it has been granted,
+                // the waiter is reused for every intersection
+                int approach, exit;
+                chooseNextEdge(approach, exit);
+                _world->getIntersection(_currDestinationID).addVehicleToQueue(_id, approach, exit, _entryWaiter);
 
                 // slow down and set intersection flag
                 _speed /= 10.0;
-                hasEnteredIntersection = true;
+                _hasEnteredIntersection = true;
             }
 
             // check wether intersection has been crossed
-            if (completion >= 1.0 && hasEnteredIntersection)
+            if (completion >= 1.0 && _hasEnteredIntersection)
             {
-                // choose next street and destination
-                std::vector<std::shared_ptr<Street>> streetOptions = _currDestination->queryStreets(_currStreet);
-                std::shared_ptr<Street> nextStreet;
-                if (streetOptions.size() > 0)
-                {
-                    // pick one street at random and query intersection to enter this street
-                    std::random_device rd;
-                    std::mt19937 eng(rd());
-                    std::uniform_int_distribution<> distr(0, streetOptions.size() - 1);
-                    nextStreet = streetOptions.at(distr(eng));
-                }
-                else
-                {
-                    // this street is a dead-end, so drive back the same way
-                    nextStreet = _currStreet;
-                }
-                
-                // pick the one intersection at which the vehicle is currently not
-                std::shared_ptr<Intersection> nextIntersection = nextStreet->getInIntersection()->getID() == _currDestination->getID() ? nextStreet->getOutIntersection() : nextStreet->getInIntersection(); 
-
-                // send signal to intersection that vehicle has left the intersection
-                _currDestination->vehicleHasLeft(get_shared_this());
-
-                // assign new street and destination
-                this->setCurrentDestination(nextIntersection);
-                this->setCurrentStreet(nextStreet);
-
-                // reset speed and intersection flag
-                _speed *= 10.0;
-                hasEnteredIntersection = false;
+                turnIntoNextStreet();
             }
 
             // reset stop watch for next cycle
@@ -127,3 +307,68 @@ void Vehicle::drive()
         }
     } // eof simulation loop
 }
+
+// updates the position with a constant velocity motion model and returns the completion rate of the current street
+double Vehicle::moveAlongStreet(double dt)
+{
+    _posStreet += _speed * dt;
+
+    // compute completion rate of current street
+    double completion = _posStreet / _currEdge->length;
+
+    // compute current pixel position on street based on driving direction
+    double xv, yv, dx, dy;
+    dx = _currEdge->x2 - _currEdge->x1;
+    dy = _currEdge->y2 - _currEdge->y1;
+    xv = _currEdge->x1 + completion * dx; // new position based on line equation in parameter form
+    yv = _currEdge->y1 + completion * dy;
+    this->setPosition(xv, yv);
+
+    return completion;
+}
+
+// chooses the street to continue on before requesting entry, so that the intersection knows the movement of the vehicle
+void Vehicle::chooseNextEdge(int &approach, int &exit)
+{
+    // choose next street and destination from the span of streets leaving the intersection
+    const RoadGraph &roadGraph = _world->getRoadGraph();
+    int nChoices = roadGraph.getNumChoices(_currDestinationID);
+
+    // pick one street at random, a dead-end leaves the same street as the only choice
+    _nextEdge = &roadGraph.getChoice(_currDestinationID, _currStreetID, _random.uniformInt(nChoices));
+
+    // approaches and exits are numbered like the edges leaving the intersection
+    const RoadEdge *edges = roadGraph.getEdges(_currDestinationID);
+    approach = &roadGraph.findEdge(_currDestinationID, _currStreetID) - edges;
+    exit = _nextEdge - edges;
+}
+
+// leaves the current destination and continues on the street chosen when requesting entry
+void Vehicle::turnIntoNextStreet()
+{
+    const RoadEdge &nextEdge = *_nextEdge;
+
+    // send signal to intersection that vehicle has left the intersection
+    _world->getIntersection(_currDestinationID).vehicleHasLeft(_id);
+
+    // assign new street and destination and reset the position on it
+    _currStreetID = nextEdge.streetID;
+    _currDestinationID = nextEdge.otherID;
+    _currEdge = &nextEdge;
+    _posStreet = 0.0;
+
+    // leave the lane, the scheduler lets the vehicle enter a lane of the new street once it owns it,
+    // and accelerate to cruising speed again
+    if (_table)
+    {
+        _lane->popFront();
+        _lane = nullptr;
+        _table->setDesiredSpeed(_slot, _speed);
+        _table->setSegment(_slot, nextEdge.streetID, nextEdge.length, nextEdge.x1, nextEdge.y1, nextEdge.x2, nextEdge.y2);
+    }
+    else
+    {
+        _speed *= 10.0;
+    }
+    _hasEnteredIntersection = false;
+}
@@ -2,35 +2,74 @@
 #define VEHICLE_H
 
 #include "TrafficObject.h"
+#include "Intersection.h"
+#include "RandomStream.h"
 
 // forward declarations to avoid include cycle
 class Street;
-class Intersection;
+class Lane;
+class VehicleTable;
+class World;
+class ByteWriter;
+class ByteReader;
+struct RoadEdge;
 
-class Vehicle : public TrafficObject, public std::enable_shared_from_this<Vehicle>
+class Vehicle : public TrafficObject
 {
 public:
     // constructor / desctructor
-    Vehicle();
+    Vehicle(World &world);
 
     // getters / setters
-    void setCurrentStreet(std::shared_ptr<Street> street) { _currStreet = street; };
-    void setCurrentDestination(std::shared_ptr<Intersection> destination);
+    void setCurrentStreet(Street &street);
+    void setCurrentDestination(Intersection &destination);
+    void setRandomStream(RandomStream random) { _random = random; }
+    void getPosition(double &x, double &y);
+    int getCurrentStreetID() { return _currStreetID; }
+    int getCurrentDestinationID() { return _currDestinationID; }
+    double getPositionOnStreet(); // in m
+    double getSpeed();            // in m/s
+    bool isWaitingForEntry() { return _isWaitingForEntry; }
+    bool hasEnteredIntersection() { return _hasEnteredIntersection; }
+    bool isInLane() { return _lane != nullptr; } // false between turning into a street and enterLane() (step mode only)
+    EntryWaiter &getEntryWaiter() { return _entryWaiter; }
 
     // typical behaviour methods
     void simulate();
-
-    // miscellaneous
-    std::shared_ptr<Vehicle> get_shared_this() { return shared_from_this(); }
+    void attachToTable(VehicleTable *table, int slot); // moves the motion state into a row of the given table
+    void followRow(VehicleTable *table, int slot);     // tracks its row after it has been moved, without touching the motion state
+    void enterLane();                                 // joins the back of the least occupied lane of the current street (used by the Scheduler)
+    void enterLane(int lane);                         // joins the back of the given lane of the current street
+    void updateObstacle();                            // hands the vehicle or stop line ahead to the table before it integrates
+    void step();                                      // reacts to the motion integrated by the table (used by the Scheduler)
+    void saveState(ByteWriter &writer);               // appends street, destination, routing and handshake state, between two ticks only (see Checkpoint)
+    void saveMotion(ByteWriter &writer);              // appends the row of the vehicle bit for bit
+    void restoreState(ByteReader &reader);            // before the vehicle is attached to the table of its saved destination, throws if corrupt
+    void restoreMotion(ByteReader &reader);           // once attached, the vehicle enters its saved lane afterwards
 
 private:
     // typical behaviour methods
     void drive();
+    double moveAlongStreet(double dt);
+    void chooseNextEdge(int &approach, int &exit);
+    void turnIntoNextStreet();
+    void updateEdge();
 
-    std::shared_ptr<Street> _currStreet;            // street on which the vehicle is currently on
-    std::shared_ptr<Intersection> _currDestination; // destination to which the vehicle is currently driving
-    double _posStreet;                              // position on current street
-    double _speed;                                  // ego speed in m/s
+    World *_world;                                  // registry resolving the ids below
+    int _currStreetID;                              // street on which the vehicle is currently on
+    int _currDestinationID;                         // destination to which the vehicle is currently driving
+    const RoadEdge *_currEdge;                      // cached geometry of the current street in driving direction
+    const RoadEdge *_nextEdge;                      // street to continue on, chosen when requesting entry to the destination
+    RandomStream _random;                           // source of the routing decisions of this vehicle
+    double _posStreet;                              // position on current street (unused in step mode)
+    double _speed;                                  // ego speed in m/s (cruising speed in step mode)
+    bool _hasEnteredIntersection;                   // flag indicating wether entry to the destination has been granted
+    bool _isWaitingForEntry;                        // flag indicating wether an entry request is pending (step mode only)
+    EntryWaiter _entryWaiter;                       // granted by the destination once entry is allowed
+    VehicleTable *_table;                           // table holding the motion state in step mode, nullptr otherwise
+    int _slot;                                      // row of this vehicle within _table
+    Lane *_lane;                                    // lane of the current street in step mode, nullptr otherwise
+    long _laneSeq;                                  // sequence number of this vehicle within _lane
 };
 
 #endif
\ No newline at end of file
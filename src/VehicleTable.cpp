@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+#include "VehicleTable.h"
+
+// position of the obstacle of a vehicle with a free street ahead
+static const double noObstacle = 1e30;
+
+void VehicleTable::getPosition(int slot, double &x, double &y)
+{
+    x = _posX[slot];
+    y = _posY[slot];
+}
+
+// appends a new row to every column and returns its slot index
+int VehicleTable::addVehicle(int vehicleID)
+{
+    return addRow(VehicleRow{vehicleID, -1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+}
+
+void VehicleTable::getRow(int slot, VehicleRow &row)
+{
+    row = VehicleRow{_vehicleID[slot], _streetID[slot], _posStreet[slot], _speed[slot], _desiredSpeed[slot], _invLength[slot],
+                     _x1[slot], _y1[slot], _dx[slot], _dy[slot], _completion[slot], _posX[slot], _posY[slot]};
+}
+
+// overwrites all columns except the obstacle, which is set anew before every integration
+void VehicleTable::setRow(int slot, const VehicleRow &row)
+{
+    _vehicleID[slot] = row.vehicleID;
+    _streetID[slot] = row.streetID;
+    _posStreet[slot] = row.posStreet;
+    _speed[slot] = row.speed;
+    _desiredSpeed[slot] = row.desiredSpeed;
+    _invLength[slot] = row.invLength;
+    _x1[slot] = row.x1;
+    _y1[slot] = row.y1;
+    _dx[slot] = row.dx;
+    _dy[slot] = row.dy;
+    _completion[slot] = row.completion;
+    _posX[slot] = row.posX;
+    _posY[slot] = row.posY;
+}
+
+int VehicleTable::addRow(const VehicleRow &row)
+{
+    _vehicleID.push_back(row.vehicleID);
+    _streetID.push_back(row.streetID);
+    _posStreet.push_back(row.posStreet);
+    _speed.push_back(row.speed);
+    _desiredSpeed.push_back(row.desiredSpeed);
+    _obstaclePos.push_back(noObstacle);
+    _obstacleSpeed.push_back(0.0);
+    _invLength.push_back(row.invLength);
+    _x1.push_back(row.x1);
+    _y1.push_back(row.y1);
+    _dx.push_back(row.dx);
+    _dy.push_back(row.dy);
+    _completion.push_back(row.completion);
+    _posX.push_back(row.posX);
+    _posY.push_back(row.posY);
+
+    return _posStreet.size() - 1;
+}
+
+// keeps the rows contiguous by filling the hole with the last row
+int VehicleTable::removeRow(int slot)
+{
+    int last = _posStreet.size() - 1;
+    int movedID = -1;
+    if (slot != last)
+    {
+        VehicleRow row;
+        getRow(last, row);
+        setRow(slot, row);
+        _obstaclePos[slot] = _obstaclePos[last];
+        _obstacleSpeed[slot] = _obstacleSpeed[last];
+        movedID = row.vehicleID;
+    }
+
+    _vehicleID.pop_back();
+    _streetID.pop_back();
+    _posStreet.pop_back();
+    _speed.pop_back();
+    _desiredSpeed.pop_back();
+    _obstaclePos.pop_back();
+    _obstacleSpeed.pop_back();
+    _invLength.pop_back();
+    _x1.pop_back();
+    _y1.pop_back();
+    _dx.pop_back();
+    _dy.pop_back();
+    _completion.pop_back();
+    _posX.pop_back();
+    _posY.pop_back();
+
+    return movedID;
+}
+
+void VehicleTable::setObstacle(int slot, double posStreet, double speed)
+{
+    _obstaclePos[slot] = posStreet;
+    _obstacleSpeed[slot] = speed;
+}
+
+// caches the geometry of a new street segment and resets the position along it
+void VehicleTable::setSegment(int slot, int streetID, double length, double x1, double y1, double x2, double y2)
+{
+    _streetID[slot] = streetID;
+    _posStreet[slot] = 0.0;
+    _invLength[slot] = 1.0 / length;
+    _x1[slot] = x1;
+    _y1[slot] = y1;
+    _dx[slot] = x2 - x1;
+    _dy[slot] = y2 - y1;
+    _completion[slot] = 0.0;
+    _posX[slot] = x1;
+    _posY[slot] = y1;
+}
+
+// Intelligent Driver Model for all vehicles in [begin, end) : every vehicle accelerates towards its desired speed
+// and brakes for the obstacle ahead, which it never passes. Written as a branch-free loop over non-aliasing columns,
+// so that the compiler emits SIMD instructions for it. The obstacles must have been set for the current tick.
+void VehicleTable::integrate(double dt, size_t begin, size_t end)
+{
+    double *__restrict posStreet = _posStreet.data();
+    double *__restrict speed = _speed.data();
+    const double *__restrict desiredSpeed = _desiredSpeed.data();
+    const double *__restrict obstaclePos = _obstaclePos.data();
+    const double *__restrict obstacleSpeed = _obstacleSpeed.data();
+    const double *__restrict invLength = _invLength.data();
+    const double *__restrict x1 = _x1.data();
+    const double *__restrict y1 = _y1.data();
+    const double *__restrict dx = _dx.data();
+    const double *__restrict dy = _dy.data();
+    double *__restrict completion = _completion.data();
+    double *__restrict posX = _posX.data();
+    double *__restrict posY = _posY.data();
+    const double a = _model.maxAcceleration;
+    const double s0 = _model.minGap;
+    const double T = _model.timeHeadway;
+    const double twoSqrtAB = 2.0 * std::sqrt(_model.maxAcceleration * _model.comfortableDeceleration);
+
+#pragma omp simd
+    for (size_t i = begin; i < end; i++)
+    {
+        double v = speed[i];
+        double ratio = v / desiredSpeed[i];
+        double gap = std::max(obstaclePos[i] - posStreet[i], 1e-3);
+        double desiredGap = s0 + std::max(0.0, v * T + v * (v - obstacleSpeed[i]) / twoSqrtAB);
+        double gapRatio = desiredGap / gap;
+        double acceleration = a * (1.0 - ratio * ratio * ratio * ratio - gapRatio * gapRatio);
+        v = std::max(0.0, v + acceleration * dt);
+        speed[i] = v;
+
+        // neither drive backwards nor into the obstacle
+        posStreet[i] = std::max(posStreet[i], std::min(posStreet[i] + v * dt, obstaclePos[i]));
+        double c = posStreet[i] * invLength[i];
+        completion[i] = c;
+        posX[i] = x1[i] + c * dx[i]; // new position based on line equation in parameter form
+        posY[i] = y1[i] + c * dy[i];
+    }
+}
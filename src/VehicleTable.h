@@ -0,0 +1,68 @@
+#ifndef VEHICLETABLE_H
+#define VEHICLETABLE_H
+
+#include <vector>
+#include <cstddef>
+
+// auxiliary struct holding a single row of a VehicleTable while it is handed over to another table
+struct VehicleRow
+{
+    int vehicleID, streetID;
+    double posStreet, speed, desiredSpeed, invLength, x1, y1, dx, dy, completion, posX, posY;
+};
+
+// parameters of the Intelligent Driver Model (IDM) used for car following, in the units of the simulation,
+// whose vehicles cruise at 400 m/s on streets of about 1000 m
+struct DrivingModel
+{
+    double maxAcceleration = 200.0;         // a in m/s^2
+    double comfortableDeceleration = 300.0; // b in m/s^2
+    double minGap = 10.0;                   // s0, distance to the vehicle ahead at standstill in m
+    double timeHeadway = 0.2;               // T, time gap to the vehicle ahead at constant speed in s
+    double vehicleLength = 10.0;            // in m
+};
+
+// structure-of-arrays store for the motion state of all vehicles advanced by the Scheduler,
+// laid out contiguously so that the per-tick motion update can be vectorized across vehicles
+class VehicleTable
+{
+public:
+    // getters / setters
+    size_t getSize() { return _posStreet.size(); }
+    int getVehicleID(int slot) { return _vehicleID[slot]; }
+    int getStreetID(int slot) { return _streetID[slot]; }
+    double getPosStreet(int slot) { return _posStreet[slot]; }
+    double getCompletion(int slot) { return _completion[slot]; }
+    double getSpeed(int slot) { return _speed[slot]; }
+    void setSpeed(int slot, double speed) { _speed[slot] = speed; }
+    void setDesiredSpeed(int slot, double desiredSpeed) { _desiredSpeed[slot] = desiredSpeed; }
+    void setObstacle(int slot, double posStreet, double speed); // rear end of whatever is ahead, posStreet beyond the street for nothing
+    const DrivingModel &getDrivingModel() { return _model; }
+    void getPosition(int slot, double &x, double &y);
+
+    // typical behaviour methods
+    int addVehicle(int vehicleID);
+    void getRow(int slot, VehicleRow &row);
+    void setRow(int slot, const VehicleRow &row);
+    int addRow(const VehicleRow &row);
+    int removeRow(int slot); // moves the last row into the slot and returns the id of its vehicle, -1 if the slot was last
+    void setSegment(int slot, int streetID, double length, double x1, double y1, double x2, double y2);
+    void integrate(double dt, size_t begin, size_t end);
+
+private:
+    std::vector<int> _vehicleID;       // id of the vehicle in each row
+    std::vector<int> _streetID;        // id of the street each vehicle is currently on
+    std::vector<double> _posStreet;    // position along the current street in m
+    std::vector<double> _speed;        // current speed in m/s
+    std::vector<double> _desiredSpeed; // speed the vehicle accelerates to on a free street in m/s
+    std::vector<double> _obstaclePos;  // position of the rear end of the vehicle or stop line ahead in m, set before every integration
+    std::vector<double> _obstacleSpeed; // speed of the obstacle ahead in m/s
+    std::vector<double> _invLength;    // reciprocal length of the current street in 1/m
+    std::vector<double> _x1, _y1;      // pixel position of the intersection the vehicle drives away from
+    std::vector<double> _dx, _dy;      // pixel offset to the intersection the vehicle drives towards
+    std::vector<double> _completion;   // completion rate of the current street
+    std::vector<double> _posX, _posY;  // current pixel position
+    DrivingModel _model;               // car-following parameters shared by all vehicles
+};
+
+#endif
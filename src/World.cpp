@@ -0,0 +1,162 @@
+#include <random>
+#include <cstring>
+#include "World.h"
+
+// random stream ids of traffic lights are kept apart from those of vehicles
+static const uint64_t trafficLightStreams = 1ull << 32;
+
+World::World()
+{
+    // non-reproducible unless a seed is set explicitly
+    _seed = std::random_device()();
+    _roadGraph = std::make_shared<RoadGraph>();
+}
+
+void World::reserve(size_t nIntersections, size_t nStreets, size_t nVehicles)
+{
+    _intersections.reserve(nIntersections);
+    _streets.reserve(nStreets);
+    _vehicles.reserve(nVehicles);
+}
+
+std::shared_ptr<Street> World::addStreet()
+{
+    std::shared_ptr<Street> street = std::make_shared<Street>();
+    street->setID(_streets.size());
+    _streets.push_back(street);
+
+    return street;
+}
+
+std::shared_ptr<Intersection> World::addIntersection()
+{
+    std::shared_ptr<Intersection> intersection = std::make_shared<Intersection>();
+    intersection->setID(_intersections.size());
+    intersection->setTrafficLightRandomStream(RandomStream(_seed, trafficLightStreams + intersection->getID()));
+    _intersections.push_back(intersection);
+
+    return intersection;
+}
+
+std::shared_ptr<Vehicle> World::addVehicle()
+{
+    std::shared_ptr<Vehicle> vehicle = std::make_shared<Vehicle>(*this);
+    vehicle->setID(_vehicles.size());
+    vehicle->setRandomStream(RandomStream(_seed, vehicle->getID()));
+    _vehicles.push_back(vehicle);
+
+    return vehicle;
+}
+
+void World::buildRoadGraph()
+{
+    std::shared_ptr<RoadGraph> roadGraph = std::make_shared<RoadGraph>();
+    roadGraph->build(*this);
+    _roadGraph = roadGraph;
+    attachRoadGraph();
+}
+
+void World::setRoadGraph(std::shared_ptr<const RoadGraph> roadGraph)
+{
+    _roadGraph = roadGraph;
+    attachRoadGraph();
+}
+
+// intersections number their approaches and movements like their edges in the road graph
+void World::attachRoadGraph()
+{
+    for (auto &intersection : _intersections)
+    {
+        intersection->setRoadGraph(*_roadGraph);
+    }
+}
+
+bool World::publishSnapshot(double simulationTime)
+{
+    // publish at the rate at which the renderer consumes, so a slow or missing renderer costs nothing
+    if (!_snapshots.isConsumed())
+    {
+        return false;
+    }
+
+    // the back buffer keeps its capacity, so this does not allocate in steady state
+    writeSnapshot(_snapshots.getBackBuffer(), simulationTime);
+    _snapshots.publish();
+    return true;
+}
+
+void World::writeSnapshot(Snapshot &snapshot, double simulationTime)
+{
+    snapshot.objects.resize(_intersections.size() + _vehicles.size());
+    snapshot.simulationTime = simulationTime;
+    size_t idx = 0;
+    for (auto &intersection : _intersections)
+    {
+        SnapshotObject &object = snapshot.objects[idx++];
+        double x, y;
+        intersection->getPosition(x, y);
+        object.x = x;
+        object.y = y;
+        object.type = ObjectType::objectIntersection;
+        object.phase = intersection->trafficLightIsGreen() ? TrafficLightPhase::green : TrafficLightPhase::red;
+        object.color[0] = 0;
+        object.color[1] = object.phase == TrafficLightPhase::green ? 255 : 0;
+        object.color[2] = object.phase == TrafficLightPhase::green ? 0 : 255;
+    }
+    for (auto &vehicle : _vehicles)
+    {
+        SnapshotObject &object = snapshot.objects[idx++];
+        double x, y;
+        vehicle->getPosition(x, y);
+        object.x = x;
+        object.y = y;
+        object.type = ObjectType::objectVehicle;
+        object.phase = TrafficLightPhase::red;
+        getVehicleColor(vehicle->getID(), object.color);
+    }
+}
+
+// FNV-1a over the bits of all positions
+uint64_t World::getChecksum()
+{
+    uint64_t checksum = 14695981039346656037ull;
+    for (auto &vehicle : _vehicles)
+    {
+        double position[2];
+        vehicle->getPosition(position[0], position[1]);
+        uint64_t bits[2];
+        std::memcpy(bits, position, sizeof(bits));
+        checksum = (checksum ^ bits[0]) * 1099511628211ull;
+        checksum = (checksum ^ bits[1]) * 1099511628211ull;
+    }
+    return checksum;
+}
+
+// FNV-1a over the wiring and geometry of the network, vehicles and signal plans are left out
+uint64_t World::getMapFingerprint()
+{
+    uint64_t fingerprint = 14695981039346656037ull;
+    auto mix = [&fingerprint](uint64_t bits) {
+        fingerprint = (fingerprint ^ bits) * 1099511628211ull;
+    };
+    for (auto &street : _streets)
+    {
+        double length = street->getLength();
+        uint64_t bits;
+        std::memcpy(&bits, &length, sizeof(bits));
+        mix(street->getOutIntersectionID());
+        mix(street->getInIntersectionID());
+        mix(bits);
+        mix(street->getNumLanes());
+    }
+    for (auto &intersection : _intersections)
+    {
+        double position[2];
+        intersection->getPosition(position[0], position[1]);
+        uint64_t bits[2];
+        std::memcpy(bits, position, sizeof(bits));
+        mix(bits[0]);
+        mix(bits[1]);
+    }
+    return fingerprint;
+}
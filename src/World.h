@@ -0,0 +1,59 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Street.h"
+#include "Intersection.h"
+#include "Vehicle.h"
+#include "RoadGraph.h"
+#include "Snapshot.h"
+
+// registry which owns all streets, intersections and vehicles of a simulation. Every object
+// registered here gets the index within the array of its type as id, so that objects refer to
+// each other by plain 32-bit ids and resolve them without touching any reference count.
+class World
+{
+public:
+    // constructor / desctructor
+    World();
+
+    // getters / setters
+    void setSeed(uint64_t seed) { _seed = seed; } // must be called before objects are added
+    uint64_t getSeed() { return _seed; }
+    Street &getStreet(int id) { return *_streets[id]; }
+    Intersection &getIntersection(int id) { return *_intersections[id]; }
+    Vehicle &getVehicle(int id) { return *_vehicles[id]; }
+    std::vector<std::shared_ptr<Street>> &getStreets() { return _streets; }
+    std::vector<std::shared_ptr<Intersection>> &getIntersections() { return _intersections; }
+    std::vector<std::shared_ptr<Vehicle>> &getVehicles() { return _vehicles; }
+    const RoadGraph &getRoadGraph() { return *_roadGraph; }
+    std::shared_ptr<const RoadGraph> getSharedRoadGraph() { return _roadGraph; }
+    SnapshotBuffer &getSnapshotBuffer() { return _snapshots; }
+
+    // typical behaviour methods
+    void reserve(size_t nIntersections, size_t nStreets, size_t nVehicles); // avoids regrowing the registries while a large network is built
+    std::shared_ptr<Street> addStreet();
+    std::shared_ptr<Intersection> addIntersection();
+    std::shared_ptr<Vehicle> addVehicle();
+    void buildRoadGraph(); // call once all streets and intersections are wired
+    void setRoadGraph(std::shared_ptr<const RoadGraph> roadGraph); // shares the immutable graph of an identical network instead of building one
+    bool publishSnapshot(double simulationTime = 0.0);  // hands the current state to the renderer, unless it still has an unread one
+    void writeSnapshot(Snapshot &snapshot, double simulationTime); // copies the current state of all objects
+    uint64_t getChecksum(); // fingerprint of all vehicle positions, so that runs can be compared bit for bit
+    uint64_t getMapFingerprint(); // fingerprint of the streets and intersections, so that saved states can be matched to their map
+
+private:
+    // typical behaviour methods
+    void attachRoadGraph();
+
+    std::vector<std::shared_ptr<Street>> _streets;             // all streets, indexed by id
+    std::vector<std::shared_ptr<Intersection>> _intersections; // all intersections, indexed by id
+    std::vector<std::shared_ptr<Vehicle>> _vehicles;           // all vehicles, indexed by id
+    std::shared_ptr<const RoadGraph> _roadGraph;               // adjacency of streets and intersections used for routing, may be shared
+    SnapshotBuffer _snapshots;                                 // state of all objects as published for the renderer
+    uint64_t _seed;                                            // every random stream of this world is derived from it
+};
+
+#endif